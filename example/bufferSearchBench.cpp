@@ -0,0 +1,137 @@
+/**
+ * @brief Buffer分隔符查找基准，与std::search/std::find对比
+ * 1. 增量到达：一个请求分成多个小段到达，每到一段查找一次"\r\n"(每次从头std::search / 每次从头findCRLF(start) / 增量findCRLF())
+ * 2. 交替查找：每到一段既找"\r\n"又找':'(如HTTP头的行尾和字段分隔)，各分隔符的扫描位置分别记录，互不清除
+ * 3. 单次扫描：在大块数据中查找，报告吞吐量
+ * 用法: bufferSearchBench [请求字节数=16384] [每段字节数=512] [重复次数=2000]
+ */
+#include "Buffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+namespace
+{
+    const char kCRLF[] = "\r\n";
+
+    enum Method
+    {
+        kStdSearch,      // 每次从头std::search/std::find
+        kRescan,         // 每次从头findCRLF(start)/findEOL(start)等SIMD实现
+        kIncremental,    // 无参数版本，只扫描新到达的数据
+    };
+
+    const char *methodName(Method method)
+    {
+        switch (method)
+        {
+        case kStdSearch:
+            return "std::search/find rescan";
+        case kRescan:
+            return "findCRLF(start) rescan";
+        case kIncremental:
+            return "findCRLF() incremental";
+        }
+        return "";
+    }
+
+    const char *searchCRLF(const Buffer &buf, Method method)
+    {
+        const char *end = buf.beginWrite();
+        if (method == kStdSearch)
+        {
+            const char *pos = std::search(buf.peek(), end, kCRLF, kCRLF + 2);
+            return pos == end ? nullptr : pos;
+        }
+        return method == kRescan ? buf.findCRLF(buf.peek()) : buf.findCRLF();
+    }
+
+    const char *searchColon(const Buffer &buf, Method method)
+    {
+        const char *end = buf.beginWrite();
+        if (method == kIncremental)
+        {
+            return buf.findByte(':');
+        }
+        // findByte没有带start的版本，整段重扫时两种方式都用std::find
+        const char *pos = std::find(buf.peek(), end, ':');
+        return pos == end ? nullptr : pos;
+    }
+
+    // 返回每个请求的微秒数
+    double runArrival(const std::string &request, size_t pieceSize, int rounds, Method method, bool alternate, long *sink)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r)
+        {
+            Buffer buf;
+            for (size_t pos = 0; pos < request.size(); pos += pieceSize)
+            {
+                buf.append(request.data() + pos, std::min(pieceSize, request.size() - pos));
+                *sink += searchCRLF(buf, method) != nullptr;
+                if (alternate)
+                {
+                    *sink += searchColon(buf, method) != nullptr;
+                }
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return seconds * 1e6 / rounds;
+    }
+
+    // 返回GB/s
+    double runSinglePass(const Buffer &buf, bool useStdSearch, int rounds, long *sink)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r)
+        {
+            const char *end = buf.beginWrite();
+            const char *pos = useStdSearch ? std::search(buf.peek(), end, kCRLF, kCRLF + 2) : buf.findCRLF(buf.peek());
+            *sink += pos - buf.peek();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return static_cast<double>(buf.readableBytes()) * rounds / seconds / 1e9;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t requestSize = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 16384;
+    size_t pieceSize = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 512;
+    int rounds = argc > 3 ? atoi(argv[3]) : 2000;
+    if (requestSize < 4 || pieceSize == 0)
+    {
+        fprintf(stderr, "usage: bufferSearchBench [requestBytes>=4] [pieceBytes>0] [rounds]\n");
+        return 1;
+    }
+
+    // 分隔符都在请求末尾，每次查找都要扫描到已到达数据的结尾
+    std::string request(requestSize, 'a');
+    request[requestSize - 4] = ':';
+    request[requestSize - 2] = '\r';
+    request[requestSize - 1] = '\n';
+
+    long sink = 0;
+    const Method methods[] = {kStdSearch, kRescan, kIncremental};
+    for (int alternate = 0; alternate < 2; ++alternate)
+    {
+        printf("%s, %zu-byte request in %zu-byte pieces:\n", alternate ? "CRLF + ':' alternately" : "CRLF", requestSize, pieceSize);
+        for (Method method : methods)
+        {
+            printf("  %-26s %8.2f us/request\n", methodName(method), runArrival(request, pieceSize, rounds, method, alternate != 0, &sink));
+        }
+    }
+
+    std::string big(1 << 20, 'a');
+    big += kCRLF;
+    Buffer buf;
+    buf.append(big.data(), big.size());
+    printf("single pass over %zu bytes:\n", big.size());
+    printf("  %-26s %8.2f GB/s\n", "std::search", runSinglePass(buf, true, 500, &sink));
+    printf("  %-26s %8.2f GB/s\n", "findCRLF(start)", runSinglePass(buf, false, 500, &sink));
+    printf("(checksum %ld)\n", sink);
+    return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * @brief 连接频繁建立/关闭(churn)基准
+ * 1. 映射表微基准：在已有大量活跃fd的情况下，反复执行 关闭一个fd(erase) => 新连接复用该fd(insert) => 若干次事件分发查找(find)，
+ *    对比Poller当前使用的ChannelMap与此前的std::unordered_map<int, Channel *>，报告每次churn的耗时
+ * 2. 端到端：单loop服务器保持若干空闲连接，客户端串行地 connect => close(RST)，报告服务器每秒完成的连接建立+关闭次数
+ * 用法: churnBench [活跃fd/空闲连接数=1000] [churn次数=20000] [每次churn的查找次数=8]
+ * 库的日志输出到stdout，结果输出到stderr，可用 ./churnBench > /dev/null 只看结果
+ */
+#include "ChannelMap.h"
+#include "EventLoop.h"
+#include "TcpServer.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    const uint16_t kPort = 19003;
+    const int kFirstFd = 16; // 模拟stdin/stdout、监听socket、epollfd等占用的低位fd
+
+    // 对unordered_map做与ChannelMap相同接口的包装
+    class HashChannelMap
+    {
+    public:
+        Channel *find(int fd) const
+        {
+            std::unordered_map<int, Channel *>::const_iterator it = channels_.find(fd);
+            return it == channels_.end() ? nullptr : it->second;
+        }
+        void insert(int fd, Channel *channel) { channels_[fd] = channel; }
+        void erase(int fd) { channels_.erase(fd); }
+        size_t size() const { return channels_.size(); }
+
+    private:
+        std::unordered_map<int, Channel *> channels_;
+    };
+
+    // 返回每次churn的纳秒数
+    template <typename Map>
+    double runMapChurn(int numFds, long churns, int lookups, long *checksum)
+    {
+        Map map;
+        Channel *dummy = reinterpret_cast<Channel *>(&map);
+        for (int i = 0; i < numFds; ++i)
+        {
+            map.insert(kFirstFd + i, dummy);
+        }
+
+        // 固定种子的线性同余序列，两种映射表访问完全相同的fd
+        unsigned int seed = 12345;
+        long found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (long n = 0; n < churns; ++n)
+        {
+            seed = seed * 1103515245 + 12345;
+            int fd = kFirstFd + static_cast<int>((seed >> 8) % numFds);
+            map.erase(fd);
+            map.insert(fd, dummy); // 内核分配最小可用fd，新连接复用刚关闭的fd
+            for (int k = 0; k < lookups; ++k)
+            {
+                seed = seed * 1103515245 + 12345;
+                found += map.find(kFirstFd + static_cast<int>((seed >> 8) % numFds)) != nullptr;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        *checksum += found + static_cast<long>(map.size());
+        return seconds * 1e9 / churns;
+    }
+
+    int connectToServer()
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        ::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(kPort);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        return fd;
+    }
+
+    // 以RST关闭，客户端不进入TIME_WAIT，避免大量churn耗尽临时端口
+    void abortiveClose(int fd)
+    {
+        linger lin;
+        lin.l_onoff = 1;
+        lin.l_linger = 0;
+        ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+        ::close(fd);
+    }
+
+    void waitFor(const std::atomic<long> &counter, long target)
+    {
+        while (counter.load() < target)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    void runServerChurn(int numIdle, long churns)
+    {
+        std::atomic<long> established(0);
+        std::atomic<long> closed(0);
+        std::promise<EventLoop *> started;
+        std::thread serverThread([&]()
+                                 {
+            EventLoop loop;
+            TcpServer server(&loop, InetAddress(kPort), "ChurnBench");
+            server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                         {
+                if (conn->connected())
+                {
+                    established.fetch_add(1);
+                }
+                else
+                {
+                    closed.fetch_add(1);
+                } });
+            server.setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp)
+                                      { buf->retrieveAll(); });
+            server.start();
+            started.set_value(&loop);
+            loop.loop(); });
+        EventLoop *loop = started.get_future().get();
+
+        std::vector<int> idle;
+        for (int i = 0; i < numIdle; ++i)
+        {
+            idle.push_back(connectToServer());
+        }
+        waitFor(established, numIdle);
+
+        auto start = std::chrono::steady_clock::now();
+        for (long n = 0; n < churns; ++n)
+        {
+            abortiveClose(connectToServer());
+        }
+        // 等服务器处理完所有连接的建立和关闭
+        waitFor(closed, churns);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (int fd : idle)
+        {
+            ::close(fd);
+        }
+        waitFor(closed, churns + numIdle);
+        loop->quit();
+        serverThread.join();
+
+        fprintf(stderr, "server    idle=%d churns=%ld  %.0f connect+close/s\n", numIdle, churns, churns / seconds);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int numFds = argc > 1 ? atoi(argv[1]) : 1000;
+    long churns = argc > 2 ? atol(argv[2]) : 20000;
+    int lookups = argc > 3 ? atoi(argv[3]) : 8;
+
+    // 微基准的churn次数放大，使计时远大于时钟精度
+    long mapChurns = churns * 100;
+    long checksum = 0;
+    double flatNs = runMapChurn<ChannelMap>(numFds, mapChurns, lookups, &checksum);
+    double hashNs = runMapChurn<HashChannelMap>(numFds, mapChurns, lookups, &checksum);
+    fprintf(stderr, "map       fds=%d lookups/churn=%d  ChannelMap %.1f ns/churn  unordered_map %.1f ns/churn  (checksum %ld)\n",
+            numFds, lookups, flatNs, hashNs, checksum);
+
+    runServerChurn(numFds, churns);
+    return 0;
+}
@@ -0,0 +1,247 @@
+/**
+ * @brief 大量连接下的内存占用与分配频率基准
+ * 单loop的echo服务器，客户端依次：建立N个空闲连接 => 每个连接发送一条消息并收回echo => 全部关闭，
+ * 每个阶段报告进程RSS增量、平均每连接的字节数，以及堆分配(operator new)次数和loop线程BufferPool的分配/命中次数
+ * 用法: memBench [连接数=100000] [消息字节数=1024]
+ * 客户端和服务器在同一进程，每个连接占两个fd，连接数受RLIMIT_NOFILE硬限制约束，不足时自动减少并提示；
+ * 客户端轮流绑定127.0.0.2~127.0.0.254作为源地址，避免单个源地址的临时端口耗尽
+ * 库的日志输出到stdout，结果输出到stderr，可用 ./memBench > /dev/null 只看结果
+ */
+#include "BufferPool.h"
+#include "EventLoop.h"
+#include "TcpServer.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <netinet/in.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    std::atomic<long> g_allocations(0);
+}
+
+// 统计堆分配次数
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = ::malloc(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    ::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    ::free(p);
+}
+
+namespace
+{
+    const uint16_t kPort = 19005;
+    const int kConnectionsPerSourceAddress = 20000;
+
+    long residentBytes()
+    {
+        long pages = 0;
+        long resident = 0;
+        FILE *fp = ::fopen("/proc/self/statm", "r");
+        if (fp != nullptr)
+        {
+            if (::fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+            {
+                resident = 0;
+            }
+            ::fclose(fp);
+        }
+        return resident * ::sysconf(_SC_PAGESIZE);
+    }
+
+    // 提高fd上限，返回在其约束下可建立的连接数
+    int raiseFdLimit(int wanted)
+    {
+        rlimit limit;
+        ::getrlimit(RLIMIT_NOFILE, &limit);
+        rlim_t need = static_cast<rlim_t>(wanted) * 2 + 64;
+        limit.rlim_cur = need < limit.rlim_max ? need : limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+        ::getrlimit(RLIMIT_NOFILE, &limit);
+        int possible = static_cast<int>((limit.rlim_cur - 64) / 2);
+        return possible < wanted ? possible : wanted;
+    }
+
+    int connectTo(int index)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in local;
+        ::memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl((127u << 24) | static_cast<uint32_t>(2 + index / kConnectionsPerSourceAddress));
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) < 0)
+        {
+            perror("bind");
+            exit(1);
+        }
+        sockaddr_in addr;
+        ::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(kPort);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        return fd;
+    }
+
+    void waitFor(const std::atomic<long> &counter, long target)
+    {
+        while (counter.load() < target)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    BufferPool::Stats loopPoolStats(EventLoop *loop)
+    {
+        std::promise<BufferPool::Stats> stats;
+        loop->runInLoop([&stats]()
+                        { stats.set_value(BufferPool::localStats()); });
+        return stats.get_future().get();
+    }
+
+    // 一个阶段开始时的计数
+    struct Sample
+    {
+        explicit Sample(EventLoop *loop) : rss(residentBytes()), allocations(g_allocations.load()), pool(loopPoolStats(loop)) {}
+
+        long rss;
+        long allocations;
+        BufferPool::Stats pool;
+    };
+
+    void report(const char *phase, EventLoop *loop, const Sample &before, long units, const char *unitName)
+    {
+        Sample after(loop);
+        long rssDelta = after.rss - before.rss;
+        long allocations = after.allocations - before.allocations;
+        uint64_t poolAllocations = after.pool.allocations - before.pool.allocations;
+        uint64_t poolHits = after.pool.poolHits - before.pool.poolHits;
+        fprintf(stderr, "%-8s rss %+8.1f MB (%+7.0f B/%s)  heap allocs %.2f/%s  pool allocs %.2f/%s hits %.0f%%  pool in use %.1f MB cached %.1f MB\n",
+                phase, rssDelta / 1048576.0, static_cast<double>(rssDelta) / units, unitName,
+                static_cast<double>(allocations) / units, unitName,
+                static_cast<double>(poolAllocations) / units, unitName,
+                poolAllocations > 0 ? 100.0 * poolHits / poolAllocations : 0.0,
+                after.pool.inUseBytes / 1048576.0, after.pool.cachedBytes / 1048576.0);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int wanted = argc > 1 ? atoi(argv[1]) : 100000;
+    size_t msgSize = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 1024;
+    int numConnections = raiseFdLimit(wanted);
+    if (numConnections < wanted)
+    {
+        fprintf(stderr, "RLIMIT_NOFILE allows only %d of %d connections, raise the hard limit (ulimit -Hn) for the full run\n",
+                numConnections, wanted);
+    }
+
+    std::atomic<long> established(0);
+    std::atomic<long> closed(0);
+    std::promise<EventLoop *> started;
+    std::thread serverThread([&]()
+                             {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(kPort), "MemBench");
+        server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                     {
+            if (conn->connected())
+            {
+                established.fetch_add(1);
+            }
+            else
+            {
+                closed.fetch_add(1);
+            } });
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                                  { conn->send(buf->retrieveAllAsString()); });
+        server.start();
+        started.set_value(&loop);
+        loop.loop(); });
+    EventLoop *loop = started.get_future().get();
+
+    // 建立空闲连接，每批等服务器跟上，避免backlog溢出导致SYN重传
+    std::vector<int> fds;
+    fds.reserve(numConnections);
+    Sample beforeConnect(loop);
+    for (int i = 0; i < numConnections; ++i)
+    {
+        fds.push_back(connectTo(i));
+        if ((i + 1) % 512 == 0)
+        {
+            waitFor(established, i + 1);
+        }
+    }
+    waitFor(established, numConnections);
+    report("connect", loop, beforeConnect, numConnections, "conn");
+
+    // 每个连接一条消息，全部发出后再逐个收回echo
+    std::string message(msgSize, 'x');
+    std::vector<char> buf(msgSize);
+    Sample beforeEcho(loop);
+    for (int fd : fds)
+    {
+        if (::write(fd, message.data(), message.size()) != static_cast<ssize_t>(message.size()))
+        {
+            perror("write");
+            exit(1);
+        }
+    }
+    for (int fd : fds)
+    {
+        size_t received = 0;
+        while (received < msgSize)
+        {
+            ssize_t n = ::read(fd, buf.data(), msgSize - received);
+            if (n <= 0)
+            {
+                perror("read");
+                exit(1);
+            }
+            received += static_cast<size_t>(n);
+        }
+    }
+    report("echo", loop, beforeEcho, numConnections, "msg ");
+
+    Sample beforeClose(loop);
+    for (int fd : fds)
+    {
+        ::close(fd);
+    }
+    waitFor(closed, numConnections);
+    report("close", loop, beforeClose, numConnections, "conn");
+
+    loop->quit();
+    serverThread.join();
+    return 0;
+}
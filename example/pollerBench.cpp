@@ -0,0 +1,153 @@
+/**
+ * @brief EpollPoller与IoUringPoller对比基准
+ * 依次以epoll和io_uring后端启动单loop的echo服务，客户端在主线程用epoll驱动多个连接做ping-pong，报告每秒往返次数
+ * 用法: pollerBench [连接数=100] [每个后端运行秒数=5] [消息字节数=64]
+ * 库的日志输出到stdout，结果输出到stderr，可用 ./pollerBench > /dev/null 只看结果
+ */
+#include "EventLoop.h"
+#include "IoUringPoller.h"
+#include "TcpServer.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <fcntl.h>
+#include <future>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    struct Client
+    {
+        int fd;
+        size_t received; // 本轮已收到的字节数
+    };
+
+    int connectTo(uint16_t port)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        ::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fd;
+    }
+
+    // 返回完成的往返次数
+    long runClients(uint16_t port, int numConnections, int seconds, size_t msgSize)
+    {
+        std::string message(msgSize, 'x');
+        std::vector<char> buf(64 * 1024);
+        std::vector<Client> clients(numConnections);
+        int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        for (int i = 0; i < numConnections; ++i)
+        {
+            clients[i].fd = connectTo(port);
+            clients[i].received = 0;
+            epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.ptr = &clients[i];
+            ::epoll_ctl(epfd, EPOLL_CTL_ADD, clients[i].fd, &ev);
+            ::write(clients[i].fd, message.data(), message.size());
+        }
+
+        long roundTrips = 0;
+        std::vector<epoll_event> events(numConnections);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            int n = ::epoll_wait(epfd, events.data(), numConnections, 100);
+            for (int i = 0; i < n; ++i)
+            {
+                Client *client = static_cast<Client *>(events[i].data.ptr);
+                ssize_t len = ::read(client->fd, buf.data(), buf.size());
+                if (len <= 0)
+                {
+                    continue;
+                }
+                client->received += static_cast<size_t>(len);
+                if (client->received >= msgSize)
+                {
+                    client->received -= msgSize;
+                    ++roundTrips;
+                    ::write(client->fd, message.data(), message.size());
+                }
+            }
+        }
+
+        for (int i = 0; i < numConnections; ++i)
+        {
+            ::close(clients[i].fd);
+        }
+        ::close(epfd);
+        return roundTrips;
+    }
+
+    void runBackend(bool iouring, uint16_t port, int numConnections, int seconds, size_t msgSize)
+    {
+        if (iouring)
+        {
+            ::setenv("MUDUO_USE_IOURING", "1", 1);
+        }
+        else
+        {
+            ::unsetenv("MUDUO_USE_IOURING");
+        }
+
+        std::promise<EventLoop *> started;
+        bool ringValid = false;
+        std::thread serverThread([&]()
+                                 {
+            EventLoop loop; // newDefaultPoller在此读取环境变量
+            if (iouring)
+            {
+                IoUringPoller probe(&loop);
+                ringValid = probe.valid();
+            }
+            TcpServer server(&loop, InetAddress(port), "PollerBench");
+            server.setConnectionCallback([](const TcpConnectionPtr &) {});
+            server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                                      { conn->send(buf->retrieveAllAsString()); });
+            server.start();
+            started.set_value(&loop);
+            loop.loop(); });
+
+        EventLoop *loop = started.get_future().get();
+        auto start = std::chrono::steady_clock::now();
+        long roundTrips = runClients(port, numConnections, seconds, msgSize);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        loop->quit();
+        serverThread.join();
+
+        const char *name = iouring ? (ringValid ? "io_uring" : "io_uring(unsupported, fell back to epoll)") : "epoll";
+        fprintf(stderr, "%-10s connections=%d msg=%zuB  %.0f round trips/s\n", name, numConnections, msgSize, roundTrips / elapsed);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int numConnections = argc > 1 ? atoi(argv[1]) : 100;
+    int seconds = argc > 2 ? atoi(argv[2]) : 5;
+    size_t msgSize = argc > 3 ? static_cast<size_t>(atoi(argv[3])) : 64;
+
+    runBackend(false, 19001, numConnections, seconds, msgSize);
+    runBackend(true, 19002, numConnections, seconds, msgSize);
+    return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * @brief 跨线程释放时BufferPool的内存归属基准
+ * worker线程构造消息Buffer(写入数据，first-touch在worker上)，交给loop线程释放，模拟在worker上构造、由send(Buffer&&)
+ * 交给loop发送的路径。分批进行，每批等loop释放完再开始下一批，报告：
+ * worker的池命中率和收到的归还块数、loop线程池中缓存的字节数(块被留在释放线程时不断增长)、每条消息的耗时，
+ * 以及worker取得的内存页所在NUMA节点与worker所在节点相同的比例(内核不支持move_pages时不报告)
+ * 用法: poolLocalityBench [消息数=200000] [消息字节数=4096] [每批消息数=256] [worker绑定的cpu=-1] [loop绑定的cpu=-1]
+ * 多节点机器上把两个线程绑到不同节点的cpu，才能看出first-touch的效果
+ * 库的日志输出到stdout，结果输出到stderr，可用 ./poolLocalityBench > /dev/null 只看结果
+ */
+#include "Buffer.h"
+#include "BufferPool.h"
+#include "EventLoop.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    void pinTo(int cpu)
+    {
+        if (cpu < 0)
+        {
+            return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) != 0)
+        {
+            fprintf(stderr, "cannot pin to cpu %d\n", cpu);
+        }
+    }
+
+    int currentNode()
+    {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        {
+            return -1;
+        }
+        return static_cast<int>(node);
+    }
+
+    // 返回addr所在页的NUMA节点，不支持时返回负数
+    int pageNode(const void *addr)
+    {
+        long pageSize = ::sysconf(_SC_PAGESIZE);
+        void *page = reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(addr) & ~static_cast<uintptr_t>(pageSize - 1));
+        int status = -1;
+        if (::syscall(SYS_move_pages, 0, 1UL, &page, nullptr, &status, 0) != 0)
+        {
+            return -1;
+        }
+        return status;
+    }
+
+    void waitFor(const std::atomic<long> &counter, long target)
+    {
+        while (counter.load() < target)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    BufferPool::Stats loopPoolStats(EventLoop *loop)
+    {
+        std::promise<BufferPool::Stats> stats;
+        loop->runInLoop([&stats]()
+                        { stats.set_value(BufferPool::localStats()); });
+        return stats.get_future().get();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    long messages = argc > 1 ? atol(argv[1]) : 200000;
+    size_t msgSize = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 4096;
+    long batch = argc > 3 ? atol(argv[3]) : 256;
+    int workerCpu = argc > 4 ? atoi(argv[4]) : -1;
+    int loopCpu = argc > 5 ? atoi(argv[5]) : -1;
+    if (messages <= 0 || msgSize == 0 || batch <= 0)
+    {
+        fprintf(stderr, "usage: poolLocalityBench [messages>0] [msgBytes>0] [batch>0] [workerCpu] [loopCpu]\n");
+        return 1;
+    }
+
+    std::promise<EventLoop *> started;
+    std::thread loopThread([&]()
+                           {
+        pinTo(loopCpu);
+        EventLoop loop;
+        started.set_value(&loop);
+        loop.loop(); });
+    EventLoop *loop = started.get_future().get();
+
+    std::atomic<long> freed(0);
+    long sameNode = 0;
+    long checkedPages = 0;
+    BufferPool::Stats workerStats;
+    double seconds = 0;
+    std::thread worker([&]()
+                       {
+        pinTo(workerCpu);
+        int node = currentNode();
+        std::string payload(msgSize, 'x');
+        auto start = std::chrono::steady_clock::now();
+        for (long sent = 0; sent < messages;)
+        {
+            long end = sent + batch < messages ? sent + batch : messages;
+            for (; sent < end; ++sent)
+            {
+                Buffer *buf = new Buffer;
+                buf->append(payload.data(), payload.size());
+                int n = pageNode(buf->peek());
+                if (n >= 0 && node >= 0)
+                {
+                    ++checkedPages;
+                    sameNode += n == node;
+                }
+                loop->queueInLoop([buf, &freed]()
+                                  {
+                    delete buf;
+                    freed.fetch_add(1); });
+            }
+            waitFor(freed, sent);
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        workerStats = BufferPool::localStats(); });
+    worker.join();
+    BufferPool::Stats loopStats = loopPoolStats(loop);
+
+    fprintf(stderr, "messages=%ld x %zu B batch=%ld  %.0f ns/msg\n", messages, msgSize, batch, seconds * 1e9 / messages);
+    fprintf(stderr, "worker pool: hits %.1f%%  returned by other threads %llu  in use %.1f KB\n",
+            workerStats.allocations > 0 ? 100.0 * workerStats.poolHits / workerStats.allocations : 0.0,
+            static_cast<unsigned long long>(workerStats.remoteFrees), workerStats.inUseBytes / 1024.0);
+    fprintf(stderr, "loop pool:   cached %.1f KB\n", loopStats.cachedBytes / 1024.0);
+    if (checkedPages > 0)
+    {
+        fprintf(stderr, "pages on the worker's node: %.1f%%\n", 100.0 * sameNode / checkedPages);
+    }
+    else
+    {
+        fprintf(stderr, "pages on the worker's node: n/a (move_pages unsupported)\n");
+    }
+
+    loop->quit();
+    loopThread.join();
+    return 0;
+}
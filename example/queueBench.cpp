@@ -0,0 +1,161 @@
+/**
+ * @brief 跨线程投递(EventLoop::queueInLoop)吞吐基准
+ * 多个常驻的生产者线程向同一个EventLoop投递小回调，统计从开始投递到全部执行完的每秒投递数，以及平均每次投递的堆分配次数
+ * 分两种场景，各先预热一轮使MpscQueue的节点缓存就绪，再计时一轮：
+ *   unbounded: 生产者不停投递，队列可能积压到远超节点缓存
+ *   bounded:   每个生产者投递batch个后等待其执行完再继续，积压深度有上限，接近服务器中的稳定状态
+ * 用法: queueBench [生产者线程数=4] [每个线程每轮投递数=1000000] [batch=64]
+ * 库的日志输出到stdout，结果输出到stderr
+ */
+#include "EventLoop.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::atomic<long> g_allocations(0);
+}
+
+// 统计堆分配次数
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = ::malloc(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    ::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    ::free(p);
+}
+
+namespace
+{
+    // 生产者线程常驻，与服务器中的accept线程、工作线程一样，持续使用各自的节点缓存
+    struct Producers
+    {
+        EventLoop *loop;
+        long postsPerRound;
+        long batch;                // 0表示不等待
+        long counter;              // 只在loop线程中修改
+        std::atomic<int> round;    // 主线程递增以开始新的一轮
+        std::atomic<int> finished; // 完成投递的生产者数(累计)
+    };
+
+    void produce(Producers *producers, int rounds)
+    {
+        long *counter = &producers->counter;
+        std::atomic<long> executed(0); // 本线程投递的批次中已执行完的批次数
+        for (int r = 1; r <= rounds; ++r)
+        {
+            while (producers->round.load() < r)
+            {
+                std::this_thread::yield();
+            }
+            long batches = 0;
+            for (long n = 1; n <= producers->postsPerRound; ++n)
+            {
+                producers->loop->queueInLoop([counter]()
+                                             { ++*counter; });
+                if (producers->batch > 0 && (n % producers->batch == 0 || n == producers->postsPerRound))
+                {
+                    std::atomic<long> *done = &executed;
+                    producers->loop->queueInLoop([done]()
+                                                 { done->fetch_add(1); });
+                    ++batches;
+                    while (executed.load() < batches)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+            executed.store(0);
+            producers->finished.fetch_add(1);
+        }
+    }
+
+    // 开始第round轮，返回从开始投递到全部执行完的耗时(秒)
+    double runRound(Producers *producers, int numProducers, int round)
+    {
+        auto start = std::chrono::steady_clock::now();
+        producers->round.store(round);
+        while (producers->finished.load() < numProducers * round)
+        {
+            std::this_thread::yield();
+        }
+        // 所有生产者投递完之后再投递，必然在它们之后执行
+        std::promise<void> done;
+        producers->loop->queueInLoop([&done]()
+                                     { done.set_value(); });
+        done.get_future().wait();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void runScenario(EventLoop *loop, int numProducers, long postsPerRound, long batch)
+    {
+        Producers producers;
+        producers.loop = loop;
+        producers.postsPerRound = postsPerRound;
+        producers.batch = batch;
+        producers.counter = 0;
+        producers.round.store(0);
+        producers.finished.store(0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < numProducers; ++i)
+        {
+            threads.push_back(std::thread(produce, &producers, 2));
+        }
+
+        runRound(&producers, numProducers, 1); // 预热
+        long allocationsBefore = g_allocations.load();
+        double seconds = runRound(&producers, numProducers, 2);
+        long allocations = g_allocations.load() - allocationsBefore;
+        for (std::thread &t : threads)
+        {
+            t.join();
+        }
+
+        long totalPosts = numProducers * postsPerRound;
+        fprintf(stderr, "%-9s producers=%d posts=%ld  %.2fM posts/s  %.4f allocations/post\n",
+                batch > 0 ? "bounded" : "unbounded", numProducers, totalPosts, totalPosts / seconds / 1e6,
+                static_cast<double>(allocations) / totalPosts);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int numProducers = argc > 1 ? atoi(argv[1]) : 4;
+    long postsPerRound = argc > 2 ? atol(argv[2]) : 1000000;
+    long batch = argc > 3 ? atol(argv[3]) : 64;
+
+    std::promise<EventLoop *> started;
+    std::thread loopThread([&started]()
+                           {
+        EventLoop loop;
+        started.set_value(&loop);
+        loop.loop(); });
+    EventLoop *loop = started.get_future().get();
+
+    runScenario(loop, numProducers, postsPerRound, 0);
+    runScenario(loop, numProducers, postsPerRound, batch);
+
+    loop->quit();
+    loopThread.join();
+    return 0;
+}
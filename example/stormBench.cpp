@@ -0,0 +1,145 @@
+/**
+ * @brief 连接风暴(connection storm)基准
+ * 客户端在短时间内集中发起大量连接，使其堆积在监听socket的backlog中，统计服务器从第一个connect到全部连接建立完成的速率；
+ * 每轮风暴结束后以RST关闭全部连接，等待服务器处理完再开始下一轮。对不同的accept批大小(TcpServer::setAcceptBatchSize)分别测试
+ * 用法: stormBench [每轮连接数=1000] [轮数=5] [io线程数=2] [批大小列表=1,16,64]
+ * 每轮连接数不要超过监听backlog(1024)和somaxconn，否则SYN重传会主导耗时
+ * 库的日志输出到stdout，结果输出到stderr，可用 ./stormBench > /dev/null 只看结果
+ */
+#include "EventLoop.h"
+#include "TcpServer.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    int connectTo(uint16_t port)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        ::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        // 三次握手由内核完成，服务器尚未accept时connect也会返回，连接堆积在backlog中
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        return fd;
+    }
+
+    // 以RST关闭，客户端不进入TIME_WAIT，避免多轮风暴耗尽临时端口
+    void abortiveClose(int fd)
+    {
+        linger lin;
+        lin.l_onoff = 1;
+        lin.l_linger = 0;
+        ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+        ::close(fd);
+    }
+
+    void waitFor(const std::atomic<long> &counter, long target)
+    {
+        while (counter.load() < target)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    void runBatchSize(int batchSize, uint16_t port, int stormSize, int storms, int numThreads)
+    {
+        std::atomic<long> established(0);
+        std::atomic<long> closed(0);
+        std::promise<EventLoop *> started;
+        std::thread serverThread([&]()
+                                 {
+            EventLoop loop;
+            TcpServer server(&loop, InetAddress(port), "StormBench");
+            server.setThreadNum(numThreads);
+            server.setAcceptBatchSize(batchSize);
+            server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                         {
+                if (conn->connected())
+                {
+                    established.fetch_add(1);
+                }
+                else
+                {
+                    closed.fetch_add(1);
+                } });
+            server.setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp)
+                                      { buf->retrieveAll(); });
+            server.start();
+            started.set_value(&loop);
+            loop.loop(); });
+        EventLoop *loop = started.get_future().get();
+
+        double totalSeconds = 0;
+        double worstSeconds = 0;
+        std::vector<int> fds;
+        for (int s = 1; s <= storms; ++s)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < stormSize; ++i)
+            {
+                fds.push_back(connectTo(port));
+            }
+            waitFor(established, static_cast<long>(stormSize) * s);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            totalSeconds += seconds;
+            if (seconds > worstSeconds)
+            {
+                worstSeconds = seconds;
+            }
+
+            for (int fd : fds)
+            {
+                abortiveClose(fd);
+            }
+            fds.clear();
+            waitFor(closed, static_cast<long>(stormSize) * s);
+        }
+        loop->quit();
+        serverThread.join();
+
+        fprintf(stderr, "batch=%-4d storm=%d x %d io threads=%d  %.0f connections/s  worst storm %.1f ms\n",
+                batchSize, stormSize, storms, numThreads, static_cast<double>(stormSize) * storms / totalSeconds, worstSeconds * 1000);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int stormSize = argc > 1 ? atoi(argv[1]) : 1000;
+    int storms = argc > 2 ? atoi(argv[2]) : 5;
+    int numThreads = argc > 3 ? atoi(argv[3]) : 2;
+    std::string batchList = argc > 4 ? argv[4] : "1,16,64";
+
+    uint16_t port = 19004;
+    size_t pos = 0;
+    while (pos < batchList.size())
+    {
+        size_t comma = batchList.find(',', pos);
+        if (comma == std::string::npos)
+        {
+            comma = batchList.size();
+        }
+        int batchSize = atoi(batchList.substr(pos, comma - pos).c_str());
+        runBatchSize(batchSize, port++, stormSize, storms, numThreads);
+        pos = comma + 1;
+    }
+    return 0;
+}
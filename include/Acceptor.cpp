@@ -3,6 +3,7 @@
 #include "Logger.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -17,7 +18,7 @@ static int createNonblocking()
     return sockfd;
 }
 
-Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport) : loop_(loop), acceptSocket_(createNonblocking()), acceptChannel_(loop, acceptSocket_.fd()), listenning_(false)
+Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport) : loop_(loop), acceptSocket_(createNonblocking()), acceptChannel_(loop, acceptSocket_.fd()), listenning_(false), acceptBatchSize_(kDefaultAcceptBatchSize), idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
     acceptSocket_.setReuseAddr(true);
     acceptSocket_.setReusePort(reuseport);
@@ -32,6 +33,10 @@ Acceptor::~Acceptor()
 {
     acceptChannel_.disableAll(); // 把从Poller中感兴趣的事件移除
     acceptChannel_.remove();     // 调用EventLoop->removeCannel => Poller->removeChannel把Poller的ChannelMap对应的部分删除
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+    }
 }
 
 void Acceptor::listen()
@@ -43,25 +48,54 @@ void Acceptor::listen()
 
 void Acceptor::handleRead()
 {
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd >= 0)
+    // 一次读事件尽量取完backlog中的连接，最多acceptBatchSize_个，剩余的由水平触发在下一轮继续处理
+    int accepted = 0;
+    while (accepted < acceptBatchSize_)
     {
-        if (newConnectionCallback_)
+        InetAddress peerAddr;
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if (connfd >= 0)
+        {
+            ++accepted;
+            if (newConnectionCallback_)
+            {
+                newConnectionCallback_(connfd, peerAddr); // 轮询找到subLoop，唤醒并分发当前的新客户端Channel
+            }
+            else
+            {
+                ::close(connfd);
+            }
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        else if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO)
         {
-            newConnectionCallback_(connfd, peerAddr); // 轮询找到subLoop，唤醒并分发当前的新客户端Channel
+            continue; // 对端在accept前已断开等瞬时错误，继续接收下一个
+        }
+        else if ((errno == EMFILE || errno == ENFILE) && idleFd_ >= 0)
+        {
+            // fd耗尽时listenfd一直可读，不处理会使loop空转；释放预留fd，接收连接后立即关闭，再重新预留
+            LOG_ERROR("%s:%s:%d sockdf reached limit, shedding connection\n", __FILE__, __FUNCTION__, __LINE__);
+            ::close(idleFd_);
+            idleFd_ = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+            if (idleFd_ >= 0)
+            {
+                ::close(idleFd_);
+            }
+            idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+            ++accepted;
         }
         else
         {
-            ::close(connfd);
+            LOG_ERROR("%s:%s:%d accept err: %d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+            break;
         }
     }
-    else
+
+    if (accepted > 0 && acceptBatchCallback_)
     {
-        LOG_ERROR("%s:%s:%d accept err: %d\n", __FILE__, __FUNCTION__, __LINE__, errno);
-        if (errno == EMFILE)
-        {
-            LOG_ERROR("%s:%s:%d sockdf reached limit\n", __FILE__, __FUNCTION__, __LINE__);
-        }
+        acceptBatchCallback_();
     }
 }
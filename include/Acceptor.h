@@ -16,11 +16,18 @@ class Acceptor : public noncopyable
 {
 public:
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress &)>;
+    using AcceptBatchCallback = std::function<void()>;
+
+    static const int kDefaultAcceptBatchSize = 64;
 
     Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport);
     ~Acceptor();
     // 设置新连接的回调函数
     void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+    // 设置一轮accept结束后的回调，可用于把本轮接收的连接批量分发给subloop
+    void setAcceptBatchCallback(const AcceptBatchCallback &cb) { acceptBatchCallback_ = cb; }
+    // 每次读事件最多accept的连接数，避免连接风暴时长时间占用loop
+    void setAcceptBatchSize(int n) { acceptBatchSize_ = n > 0 ? n : 1; }
     // 判断是否在监听
     bool listenning() const { return listenning_; }
     // 监听本地端口
@@ -37,6 +44,9 @@ private:
     Channel acceptChannel_; // 监听新连接的channel
 
     NewConnectionCallback newConnectionCallback_; // 新连接的回调
+    AcceptBatchCallback acceptBatchCallback_;     // 一轮accept结束的回调
 
     bool listenning_; // 是否在监听
+    int acceptBatchSize_;
+    int idleFd_; // 预留的空闲fd，文件描述符耗尽时用于接收并关闭连接
 };
\ No newline at end of file
@@ -1,17 +1,161 @@
 #include "Buffer.h"
 
 #include <errno.h>
+#include <string.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // 每个线程(loop)一块readv暂存区，只在线程创建时清零一次，readFd不再每次在栈上memset 64KB
+    const size_t kExtraBufSize = 64 * 1024;
+    __thread char t_extrabuf[kExtraBufSize];
+
+    // 在[begin, end)中查找字节c
+    using FindByteFunc = const char *(*)(const char *begin, const char *end, char c);
+    // 在[begin, end)中查找相邻的两个字节first second，返回first的位置
+    using FindPairFunc = const char *(*)(const char *begin, const char *end, char first, char second);
+
+    const char *findByteScalar(const char *begin, const char *end, char c)
+    {
+        return static_cast<const char *>(::memchr(begin, c, end - begin));
+    }
+
+    const char *findPairScalar(const char *begin, const char *end, char first, char second)
+    {
+        const char *p = begin;
+        while (end - p >= 2)
+        {
+            p = static_cast<const char *>(::memchr(p, first, end - p - 1));
+            if (p == nullptr)
+            {
+                return nullptr;
+            }
+            if (p[1] == second)
+            {
+                return p;
+            }
+            ++p;
+        }
+        return nullptr;
+    }
+
+#if defined(__x86_64__)
+    // SSE2是x86-64的基础指令集，无需检测；每次比较16字节，不足16字节的尾部交给标量实现
+    const char *findByteSse2(const char *begin, const char *end, char c)
+    {
+        const __m128i target = _mm_set1_epi8(c);
+        const char *p = begin;
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, target));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findByteScalar(p, end, c);
+    }
+
+    // 同时比较p和p + 1处的16字节，两个比较结果相与即为first second相邻的位置
+    const char *findPairSse2(const char *begin, const char *end, char first, char second)
+    {
+        const __m128i target1 = _mm_set1_epi8(first);
+        const __m128i target2 = _mm_set1_epi8(second);
+        const char *p = begin;
+        for (; end - p >= 17; p += 16)
+        {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 1));
+            int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(lo, target1), _mm_cmpeq_epi8(hi, target2)));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findPairScalar(p, end, first, second);
+    }
+
+    __attribute__((target("avx2"))) const char *findByteAvx2(const char *begin, const char *end, char c)
+    {
+        const __m256i target = _mm256_set1_epi8(c);
+        const char *p = begin;
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, target)));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findByteSse2(p, end, c);
+    }
+
+    __attribute__((target("avx2"))) const char *findPairAvx2(const char *begin, const char *end, char first, char second)
+    {
+        const __m256i target1 = _mm256_set1_epi8(first);
+        const __m256i target2 = _mm256_set1_epi8(second);
+        const char *p = begin;
+        for (; end - p >= 33; p += 32)
+        {
+            __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 1));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(lo, target1), _mm256_cmpeq_epi8(hi, target2))));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findPairSse2(p, end, first, second);
+    }
+#endif
+
+    struct SearchFuncs
+    {
+        FindByteFunc findByte;
+        FindPairFunc findPair;
+    };
+
+    SearchFuncs selectSearchFuncs()
+    {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return SearchFuncs{findByteAvx2, findPairAvx2};
+        }
+        return SearchFuncs{findByteSse2, findPairSse2};
+#else
+        return SearchFuncs{findByteScalar, findPairScalar};
+#endif
+    }
+
+    // 首次使用时按CPU选定实现
+    const SearchFuncs &searchFuncs()
+    {
+        static const SearchFuncs funcs = selectSearchFuncs();
+        return funcs;
+    }
+}
+
 /**
  * 从fd上读取数据 Poller工作在LT模式
  * 从fd上读取数据时，不知道tcp数据大小，buffer_空间可能不够
- * @brief 先使用readv读取数据至buffer_，若空间不够则使用extrabuf暂存数据，再以append方式追加buffer_空间，避免系统调用带来的开销，且不影响数据接收
+ * @brief 先使用readv读取数据至buffer_，若空间不够则使用线程局部的extrabuf暂存数据，再以append方式追加buffer_空间，避免系统调用带来的开销，且不影响数据接收
+ * 第一块的大小按该连接近期的读取量预留：大流量连接的数据直接读入buffer_，不再经extrabuf拷贝；小消息连接不会为此扩容
  */
 ssize_t Buffer::readFd(int fd, int *saveErrno)
 {
-    char extrabuf[655336] = {0}; // 64KB额外栈空间
+    if (writableBytes() < readSizeHint_)
+    {
+        ensureWritableBytes(readSizeHint_);
+    }
 
     struct iovec vec[2];
     const size_t writable = writableBytes();
@@ -19,27 +163,37 @@ ssize_t Buffer::readFd(int fd, int *saveErrno)
     // 第一块缓冲区，指向可写空间
     vec[0].iov_base = begin() + writerIndex_;
     vec[0].iov_len = writable;
-    // 第二块缓冲区，指向栈空间
-    vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof(extrabuf);
+    // 第二块缓冲区，指向线程局部暂存区
+    vec[1].iov_base = t_extrabuf;
+    vec[1].iov_len = kExtraBufSize;
 
-    const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+    const int iovcnt = (writable < kExtraBufSize) ? 2 : 1;
     const ssize_t n = ::readv(fd, vec, iovcnt);
 
     if (n < 0)
     {
         *saveErrno = errno;
+        return n;
+    }
+
+    // 读取量变大时立即跟上，变小时每次衰减1/4
+    const size_t len = static_cast<size_t>(n);
+    readSizeHint_ = len >= readSizeHint_ ? len : readSizeHint_ - (readSizeHint_ - len) / 4;
+    if (readSizeHint_ > kMaxReadSizeHint)
+    {
+        readSizeHint_ = kMaxReadSizeHint;
     }
-    else if (n <= writable)
+
+    if (len <= writable)
     {
         // buffer_可写缓冲区已经够读出来的数据
-        writerIndex_ += n;
+        writerIndex_ += len;
     }
     else
     {
         // extrabuf里也写入了n - writable长度的数据
-        writerIndex_ = buffer_.size();
-        append(extrabuf, n - writable); // 对buffer_扩容，并将extrabuf存储的另一部分数据追加到buffer_
+        writerIndex_ = capacity_;
+        append(t_extrabuf, len - writable); // 对buffer_扩容，并将extrabuf存储的另一部分数据追加到buffer_
     }
     return n;
 }
@@ -53,3 +207,49 @@ ssize_t Buffer::writeFd(int fd, int *saveErrno)
     }
     return n;
 }
+
+const char *Buffer::findCRLF(const char *start) const
+{
+    return searchFuncs().findPair(start, beginWrite(), '\r', '\n');
+}
+
+const char *Buffer::findEOL(const char *start) const
+{
+    return searchFuncs().findByte(start, beginWrite(), '\n');
+}
+
+const char *Buffer::scan(int target) const
+{
+    ScanSlot *slot = nullptr;
+    for (int i = 0; i < kNumScanSlots; ++i)
+    {
+        if (scanSlots_[i].target == target)
+        {
+            slot = &scanSlots_[i];
+            break;
+        }
+    }
+    if (slot == nullptr)
+    {
+        slot = &scanSlots_[nextScanSlot_];
+        nextScanSlot_ = (nextScanSlot_ + 1) % kNumScanSlots;
+        slot->target = target;
+        slot->scannedBytes = 0;
+    }
+
+    const char *start = peek() + slot->scannedBytes;
+    const char *found = (target == kScanCRLF) ? searchFuncs().findPair(start, beginWrite(), '\r', '\n')
+                                              : searchFuncs().findByte(start, beginWrite(), static_cast<char>(target));
+    if (found != nullptr)
+    {
+        // 记到匹配处，重复查找不再扫描
+        slot->scannedBytes = found - peek();
+    }
+    else
+    {
+        // "\r\n"可能被拆在两次到达的数据之间，末尾的一个字节留到下次重新检查
+        const size_t readable = readableBytes();
+        slot->scannedBytes = (target == kScanCRLF && readable > 0) ? readable - 1 : readable;
+    }
+    return found;
+}
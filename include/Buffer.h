@@ -1,12 +1,19 @@
 #pragma once
 
+#include "BufferPool.h"
+#include "StringPiece.h"
+
 #include <algorithm>
+#include <endian.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <string>
-#include <vector>
+#include <sys/types.h>
 
 /**
  * @brief 缓冲区类
+ * 内存从当前线程(所属loop)的BufferPool分配，容量按池的分级向上取整；容量为0时指向共享的空存储，不占用内存
  */
 class Buffer
 {
@@ -14,13 +21,55 @@ public:
     static const size_t kCheapPrepend = 8; // 初始预留的prependable空间大小，用于记录数据长度
     static const size_t kInitialSize = 1024;
 
-    explicit Buffer(size_t initialSize = kInitialSize) : buffer_(kCheapPrepend + initialSize), readerIndex_(kCheapPrepend), writerIndex_(kCheapPrepend) {}
+    explicit Buffer(size_t initialSize = kInitialSize) : buffer_(emptyStorage()), capacity_(kCheapPrepend), readerIndex_(kCheapPrepend), writerIndex_(kCheapPrepend), readSizeHint_(0), nextScanSlot_(0)
+    {
+        for (int i = 0; i < kNumScanSlots; ++i)
+        {
+            scanSlots_[i].target = kScanNone;
+            scanSlots_[i].scannedBytes = 0;
+        }
+        if (initialSize > 0)
+        {
+            makeSpace(initialSize);
+        }
+    }
+
+    Buffer(const Buffer &other) : Buffer(0) { append(other.peek(), other.readableBytes()); }
+    Buffer(Buffer &&other) noexcept : buffer_(other.buffer_), capacity_(other.capacity_), readerIndex_(other.readerIndex_), writerIndex_(other.writerIndex_), readSizeHint_(other.readSizeHint_), nextScanSlot_(other.nextScanSlot_)
+    {
+        std::copy(other.scanSlots_, other.scanSlots_ + kNumScanSlots, scanSlots_);
+        other.buffer_ = emptyStorage();
+        other.capacity_ = kCheapPrepend;
+        other.readerIndex_ = kCheapPrepend;
+        other.writerIndex_ = kCheapPrepend;
+        other.resetScans();
+    }
+    Buffer &operator=(Buffer other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+    ~Buffer() { releaseStorage(); }
+
+    void swap(Buffer &other) noexcept
+    {
+        std::swap(buffer_, other.buffer_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(readerIndex_, other.readerIndex_);
+        std::swap(writerIndex_, other.writerIndex_);
+        std::swap(readSizeHint_, other.readSizeHint_);
+        std::swap_ranges(scanSlots_, scanSlots_ + kNumScanSlots, other.scanSlots_);
+        std::swap(nextScanSlot_, other.nextScanSlot_);
+    }
 
     // 可读区的数据大小
     size_t readableBytes() const { return writerIndex_ - readerIndex_; }
 
     // 可写区的数据大小
-    size_t writableBytes() const { return buffer_.size() - writerIndex_; }
+    size_t writableBytes() const { return capacity_ - writerIndex_; }
+
+    // 已分配的内存大小(含预留空间)
+    size_t internalCapacity() const { return buffer_ == emptyStorage() ? 0 : capacity_; }
 
     // 预留空间大小 = 初始预留空间大小(8) + 已读的可读取大小 = readerIndex_的值
     size_t prependableBytes() const { return readerIndex_; }
@@ -28,6 +77,74 @@ public:
     // 返回缓冲区中可读数据的起始地址
     const char *peek() const { return begin() + readerIndex_; }
 
+    // 不拷贝地查看可读区的数据，Buffer被修改后失效
+    StringPiece toStringPiece() const { return StringPiece(peek(), readableBytes()); }
+    StringPiece peekAsStringPiece(size_t len) const { return StringPiece(peek(), std::min(len, readableBytes())); }
+
+    /**
+     * @brief 在可读区中查找分隔符，找不到返回nullptr；x86-64上按CPU在运行时选用AVX2或SSE2实现
+     * 无参数的版本为每个分隔符各自记住已检查过的位置(最多同时记录kNumScanSlots个分隔符，超出时轮流替换)，
+     * 交替查找不同分隔符时互不清除，数据分多次到达时只扫描新到的部分，retrieve后相应前移
+     * 带start的版本从start开始完整扫描，不记录位置
+     */
+    // 查找"\r\n"，返回'\r'的位置
+    const char *findCRLF() const { return scan(kScanCRLF); }
+    const char *findCRLF(const char *start) const;
+    // 查找'\n'
+    const char *findEOL() const { return scan('\n'); }
+    const char *findEOL(const char *start) const;
+    // 查找任意字节
+    const char *findByte(char c) const { return scan(static_cast<unsigned char>(c)); }
+
+    /**
+     * 按网络字节序读取整数，peek不移动读指针，read读取后移动
+     * 调用者需保证readableBytes()不小于整数的字节数
+     */
+    int64_t peekInt64() const
+    {
+        int64_t be64 = 0;
+        ::memcpy(&be64, peek(), sizeof(be64));
+        return static_cast<int64_t>(be64toh(static_cast<uint64_t>(be64)));
+    }
+    int32_t peekInt32() const
+    {
+        int32_t be32 = 0;
+        ::memcpy(&be32, peek(), sizeof(be32));
+        return static_cast<int32_t>(be32toh(static_cast<uint32_t>(be32)));
+    }
+    int16_t peekInt16() const
+    {
+        int16_t be16 = 0;
+        ::memcpy(&be16, peek(), sizeof(be16));
+        return static_cast<int16_t>(be16toh(static_cast<uint16_t>(be16)));
+    }
+    int8_t peekInt8() const { return static_cast<int8_t>(*peek()); }
+
+    int64_t readInt64()
+    {
+        int64_t result = peekInt64();
+        retrieve(sizeof(result));
+        return result;
+    }
+    int32_t readInt32()
+    {
+        int32_t result = peekInt32();
+        retrieve(sizeof(result));
+        return result;
+    }
+    int16_t readInt16()
+    {
+        int16_t result = peekInt16();
+        retrieve(sizeof(result));
+        return result;
+    }
+    int8_t readInt8()
+    {
+        int8_t result = peekInt8();
+        retrieve(sizeof(result));
+        return result;
+    }
+
     // 读取len长度的空间
     void retrieve(size_t len)
     {
@@ -35,6 +152,11 @@ public:
         {
             // 读取len长度数据，可读区起始指针+len
             readerIndex_ += len;
+            for (int i = 0; i < kNumScanSlots; ++i)
+            {
+                size_t &scanned = scanSlots_[i].scannedBytes;
+                scanned = scanned > len ? scanned - len : 0;
+            }
         }
         else
         {
@@ -46,6 +168,7 @@ public:
     {
         readerIndex_ = kCheapPrepend;
         writerIndex_ = kCheapPrepend;
+        resetScans();
     }
 
     // 将可读区数据读取为string
@@ -76,19 +199,132 @@ public:
         std::copy(data, data + len, beginWrite());
         writerIndex_ += len;
     }
+    void append(const void *data, size_t len) { append(static_cast<const char *>(data), len); }
+    void append(const StringPiece &str) { append(str.data(), str.size()); }
     char *beginWrite() { return begin() + writerIndex_; }
     const char *beginWrite() const { return begin() + writerIndex_; }
 
+    // 按网络字节序追加整数
+    void appendInt64(int64_t x)
+    {
+        uint64_t be64 = htobe64(static_cast<uint64_t>(x));
+        append(&be64, sizeof(be64));
+    }
+    void appendInt32(int32_t x)
+    {
+        uint32_t be32 = htobe32(static_cast<uint32_t>(x));
+        append(&be32, sizeof(be32));
+    }
+    void appendInt16(int16_t x)
+    {
+        uint16_t be16 = htobe16(static_cast<uint16_t>(x));
+        append(&be16, sizeof(be16));
+    }
+    void appendInt8(int8_t x) { append(&x, sizeof(x)); }
+
+    /**
+     * @brief 在可读区之前写入数据，使用kCheapPrepend预留区(及已读释放的空间)，空间足够时不移动已有数据
+     * 典型用法是消息体写完后在前面补上长度头；prependableBytes() < len时先把未读数据后移或扩容
+     */
+    void prepend(const void *data, size_t len)
+    {
+        if (buffer_ == emptyStorage())
+        {
+            // 共享的空存储不可写，先分配
+            makeSpace(kInitialSize);
+        }
+        if (len > prependableBytes())
+        {
+            makePrependSpace(len);
+        }
+        readerIndex_ -= len;
+        ::memcpy(begin() + readerIndex_, data, len);
+        resetScans();
+    }
+
+    // 按网络字节序在可读区之前写入整数
+    void prependInt64(int64_t x)
+    {
+        uint64_t be64 = htobe64(static_cast<uint64_t>(x));
+        prepend(&be64, sizeof(be64));
+    }
+    void prependInt32(int32_t x)
+    {
+        uint32_t be32 = htobe32(static_cast<uint32_t>(x));
+        prepend(&be32, sizeof(be32));
+    }
+    void prependInt16(int16_t x)
+    {
+        uint16_t be16 = htobe16(static_cast<uint16_t>(x));
+        prepend(&be16, sizeof(be16));
+    }
+    void prependInt8(int8_t x) { prepend(&x, sizeof(x)); }
+
+    /**
+     * @brief 没有可读数据时把内存归还给BufferPool，之后写入时再分配
+     * 用于连接销毁或空闲时，使大量空闲连接不再各自占着突发流量时扩大的缓冲区
+     */
+    void shrinkIfEmpty()
+    {
+        if (readableBytes() == 0)
+        {
+            releaseStorage();
+            buffer_ = emptyStorage();
+            capacity_ = kCheapPrepend;
+            readerIndex_ = kCheapPrepend;
+            writerIndex_ = kCheapPrepend;
+            resetScans();
+        }
+    }
+
     // 从fd上读数据
     ssize_t readFd(int fd, int *saveErrno);
+    static const size_t kMaxReadSizeHint = 64 * 1024 - kCheapPrepend; // readFd为第一块iovec预留的最大空间，加上预留区恰好是BufferPool的64KB一级
 
     // 通过fd发数据
     ssize_t writeFd(int fd, int *saveErrno);
 
 private:
-    // vector底层数组起始地址
-    char *begin() { return &*buffer_.begin(); }
-    const char *begin() const { return &*buffer_.begin(); }
+    static const int kScanNone = -1;    // 没有记录的扫描位置
+    static const int kScanCRLF = 256;   // 0~255为单字节分隔符
+    static const int kNumScanSlots = 4; // 同时记录扫描位置的分隔符个数
+
+    struct ScanSlot
+    {
+        int target;          // 分隔符
+        size_t scannedBytes; // 可读区中已确认不含target的前缀长度，相对readerIndex_
+    };
+
+    // 可读区被整体替换或在前面插入数据后，已记录的位置全部失效
+    void resetScans() const
+    {
+        for (int i = 0; i < kNumScanSlots; ++i)
+        {
+            scanSlots_[i].scannedBytes = 0;
+        }
+    }
+
+    // 从记录的位置继续查找target，并更新记录
+    const char *scan(int target) const;
+
+    // 底层数组起始地址
+    char *begin() { return buffer_; }
+    const char *begin() const { return buffer_; }
+
+    // 容量为0的Buffer共享的存储，只有kCheapPrepend字节，不会被写入
+    static char *emptyStorage()
+    {
+        static char storage[kCheapPrepend];
+        return storage;
+    }
+
+    void releaseStorage()
+    {
+        if (buffer_ != emptyStorage())
+        {
+            BufferPool::deallocate(buffer_, capacity_);
+        }
+    }
 
     /**
      * @brief 腾出len长度的空闲空间
@@ -99,8 +335,16 @@ private:
     {
         if (writableBytes() + prependableBytes() < len + kCheapPrepend)
         {
-            // 当前可写区域不足以写入当前的内容，扩容
-            buffer_.resize(writerIndex_ + len);
+            // 当前可写区域不足以写入当前的内容，从BufferPool分配更大的内存，只拷贝未读数据
+            size_t readable = readableBytes();
+            size_t capacity = 0;
+            char *buffer = BufferPool::allocate(kCheapPrepend + readable + len, &capacity);
+            ::memcpy(buffer + kCheapPrepend, peek(), readable);
+            releaseStorage();
+            buffer_ = buffer;
+            capacity_ = capacity;
+            readerIndex_ = kCheapPrepend;
+            writerIndex_ = readerIndex_ + readable;
         }
         else
         {
@@ -112,7 +356,38 @@ private:
         }
     }
 
-    std::vector<char> buffer_;
+    /**
+     * @brief 使可读区之前至少有len字节，并在其前面保留kCheapPrepend，便于连续prepend
+     * | 已读空闲 | 未读 | 可写空闲 | => | len + kCheapPrepend | 未读 | 可写空闲 |
+     */
+    void makePrependSpace(size_t len)
+    {
+        size_t readable = readableBytes();
+        size_t headroom = len + kCheapPrepend;
+        if (capacity_ < headroom + readable)
+        {
+            // 容量不足，从BufferPool分配更大的内存，只拷贝未读数据
+            size_t capacity = 0;
+            char *buffer = BufferPool::allocate(headroom + readable, &capacity);
+            ::memcpy(buffer + headroom, peek(), readable);
+            releaseStorage();
+            buffer_ = buffer;
+            capacity_ = capacity;
+        }
+        else
+        {
+            // 将未读区后移，占用可写空闲的一部分，源和目标可能重叠
+            ::memmove(begin() + headroom, peek(), readable);
+        }
+        readerIndex_ = headroom;
+        writerIndex_ = readerIndex_ + readable;
+    }
+
+    char *buffer_;
+    size_t capacity_;
     size_t readerIndex_; // 可读区的起始位置
     size_t writerIndex_; // 空闲区的起始位置
+    size_t readSizeHint_; // 近期readFd读到的数据量(衰减的最大值)，用于决定readv第一块的大小
+    mutable ScanSlot scanSlots_[kNumScanSlots]; // 各分隔符的扫描位置
+    mutable int nextScanSlot_;                  // 新的分隔符替换的槽位
 };
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "BufferPool.h"
+
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+    // 线程退出时thread_local的池已析构，之后在该线程释放的内存直接free
+    __thread bool t_poolDestroyed = false;
+
+    std::mutex g_retiredMutex; // 保护BufferPool::retired_
+}
+
+const size_t BufferPool::kHeaderSize;
+BufferPool::ReturnList *BufferPool::retired_ = nullptr;
+
+BufferPool::BufferPool()
+    : returns_(nullptr)
+{
+    for (int i = 0; i < kNumClasses; ++i)
+    {
+        freeLists_[i] = nullptr;
+        freeCounts_[i] = 0;
+    }
+    ::memset(&stats_, 0, sizeof(stats_));
+
+    {
+        std::lock_guard<std::mutex> lock(g_retiredMutex);
+        returns_ = retired_;
+        if (returns_ != nullptr)
+        {
+            retired_ = returns_->nextRetired;
+        }
+    }
+    if (returns_ == nullptr)
+    {
+        returns_ = new ReturnList;
+    }
+    // 重新打开；仍持有旧线程块的线程此后释放时会归还到本线程，同样是有效的内存
+    returns_->nextRetired = nullptr;
+    returns_->head.store(nullptr, std::memory_order_release);
+}
+
+BufferPool::~BufferPool()
+{
+    // 关闭归还链表，此后其他线程释放本线程分配的块时直接free
+    Block *block = returns_->head.exchange(closedMarker(), std::memory_order_acquire);
+    while (block != nullptr)
+    {
+        Block *next = block->next;
+        freeBlock(reinterpret_cast<char *>(block));
+        block = next;
+    }
+    for (int i = 0; i < kNumClasses; ++i)
+    {
+        while (freeLists_[i] != nullptr)
+        {
+            Block *next = freeLists_[i]->next;
+            freeBlock(reinterpret_cast<char *>(freeLists_[i]));
+            freeLists_[i] = next;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_retiredMutex);
+        returns_->nextRetired = retired_;
+        retired_ = returns_;
+    }
+    t_poolDestroyed = true;
+}
+
+BufferPool *BufferPool::local()
+{
+    if (t_poolDestroyed)
+    {
+        return nullptr;
+    }
+    static thread_local BufferPool pool;
+    return &pool;
+}
+
+int BufferPool::sizeClass(size_t size)
+{
+    if (size <= kMinBlockSize)
+    {
+        return 0;
+    }
+    // 512 = 2^9
+    return 64 - __builtin_clzll(static_cast<unsigned long long>(size - 1)) - 9;
+}
+
+char *BufferPool::allocateBlock(size_t capacity, ReturnList *owner)
+{
+    static_assert(sizeof(Header) <= kHeaderSize, "Header does not fit in kHeaderSize");
+    char *raw = static_cast<char *>(::malloc(kHeaderSize + capacity));
+    if (raw == nullptr)
+    {
+        return nullptr;
+    }
+    Header *h = reinterpret_cast<Header *>(raw);
+    h->owner = owner;
+    h->capacity = capacity;
+    return raw + kHeaderSize;
+}
+
+void BufferPool::freeBlock(char *p)
+{
+    ::free(p - kHeaderSize);
+}
+
+BufferPool::Block *BufferPool::closedMarker()
+{
+    static Block marker;
+    return &marker;
+}
+
+char *BufferPool::allocate(size_t size, size_t *capacity)
+{
+    BufferPool *pool = local();
+    if (size > kMaxPooledSize)
+    {
+        *capacity = size;
+        if (pool != nullptr)
+        {
+            ++pool->stats_.allocations;
+            pool->stats_.inUseBytes += static_cast<int64_t>(size);
+        }
+        return static_cast<char *>(::malloc(size));
+    }
+
+    int cls = sizeClass(size);
+    *capacity = kMinBlockSize << cls;
+    if (pool == nullptr)
+    {
+        return allocateBlock(*capacity, nullptr);
+    }
+
+    ++pool->stats_.allocations;
+    pool->stats_.inUseBytes += static_cast<int64_t>(*capacity);
+    if (pool->freeLists_[cls] == nullptr && pool->returns_->head.load(std::memory_order_relaxed) != nullptr)
+    {
+        pool->drainReturns();
+    }
+    Block *block = pool->freeLists_[cls];
+    if (block != nullptr)
+    {
+        pool->freeLists_[cls] = block->next;
+        --pool->freeCounts_[cls];
+        pool->stats_.cachedBytes -= *capacity;
+        ++pool->stats_.poolHits;
+        return reinterpret_cast<char *>(block);
+    }
+    return allocateBlock(*capacity, pool->returns_);
+}
+
+void BufferPool::deallocate(char *p, size_t capacity)
+{
+    BufferPool *pool = local();
+    if (capacity > kMaxPooledSize)
+    {
+        if (pool != nullptr)
+        {
+            ++pool->stats_.deallocations;
+            pool->stats_.inUseBytes -= static_cast<int64_t>(capacity);
+        }
+        ::free(p);
+        return;
+    }
+
+    ReturnList *owner = header(p)->owner;
+    if (pool == nullptr || owner != pool->returns_)
+    {
+        // 其他线程分配的块，由分配线程在取回时计入统计
+        returnToOwner(p, owner);
+        return;
+    }
+
+    ++pool->stats_.deallocations;
+    pool->stats_.inUseBytes -= static_cast<int64_t>(capacity);
+    pool->cache(p, capacity);
+}
+
+void BufferPool::returnToOwner(char *p, ReturnList *owner)
+{
+    if (owner == nullptr)
+    {
+        freeBlock(p);
+        return;
+    }
+    Block *block = reinterpret_cast<Block *>(p);
+    Block *head = owner->head.load(std::memory_order_relaxed);
+    do
+    {
+        if (head == closedMarker())
+        {
+            freeBlock(p);
+            return;
+        }
+        block->next = head;
+    } while (!owner->head.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void BufferPool::cache(char *p, size_t capacity)
+{
+    int cls = sizeClass(capacity);
+    if ((freeCounts_[cls] + 1) * capacity > kMaxCachedBytesPerClass)
+    {
+        freeBlock(p);
+        return;
+    }
+    Block *block = reinterpret_cast<Block *>(p);
+    block->next = freeLists_[cls];
+    freeLists_[cls] = block;
+    ++freeCounts_[cls];
+    stats_.cachedBytes += capacity;
+}
+
+void BufferPool::drainReturns()
+{
+    // 只有本线程取走整个链表，不存在ABA问题
+    Block *block = returns_->head.exchange(nullptr, std::memory_order_acquire);
+    while (block != nullptr)
+    {
+        Block *next = block->next;
+        char *p = reinterpret_cast<char *>(block);
+        size_t capacity = header(p)->capacity;
+        ++stats_.deallocations;
+        ++stats_.remoteFrees;
+        stats_.inUseBytes -= static_cast<int64_t>(capacity);
+        cache(p, capacity);
+        block = next;
+    }
+}
+
+BufferPool::Stats BufferPool::localStats()
+{
+    BufferPool *pool = local();
+    if (pool == nullptr)
+    {
+        Stats empty;
+        ::memset(&empty, 0, sizeof(empty));
+        return empty;
+    }
+    return pool->stats_;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Buffer/ChainBuffer的内存池，按2的幂分级(512B ~ 1MB)缓存空闲内存块，每个线程一份
+ * one loop per thread，线程局部即每个EventLoop一份，分配释放只是链表操作，不经过全局malloc，也没有锁竞争；
+ * 每个块记录分配它的线程，在其他线程释放时(如worker线程构造、loop线程发送完的Buffer)无锁地归还分配线程，
+ * 由其在下次未命中时取回，内存不会在线程间漂移，绑核时保持first-touch所在的NUMA节点。超过kMaxPooledSize的请求直接使用malloc
+ */
+class BufferPool : noncopyable
+{
+public:
+    static const size_t kMinBlockSize = 512;
+    static const size_t kMaxPooledSize = 1024 * 1024;
+    static const size_t kMaxCachedBytesPerClass = 4 * 1024 * 1024; // 每级最多缓存的空闲内存
+
+    // 当前线程内存池的统计
+    struct Stats
+    {
+        uint64_t allocations;   // 分配次数
+        uint64_t poolHits;      // 由空闲链表满足的分配次数
+        uint64_t deallocations; // 释放次数
+        int64_t inUseBytes;     // 本线程分配减去已释放(含其他线程归还)的字节数，超过kMaxPooledSize的块跨线程释放时可能为负
+        uint64_t cachedBytes;   // 空闲链表中缓存的字节数
+        uint64_t remoteFrees;   // 其他线程释放并归还本线程的块数
+    };
+
+    /**
+     * @brief 分配至少size字节，*capacity返回实际可用大小(按级向上取整)
+     */
+    static char *allocate(size_t size, size_t *capacity);
+    // capacity必须是allocate返回的值
+    static void deallocate(char *p, size_t capacity);
+
+    // 当前线程的统计，需要某个loop的数据时在该loop中调用(如runInLoop)
+    static Stats localStats();
+
+    ~BufferPool();
+
+private:
+    static const int kNumClasses = 12; // 512B << 11 = 1MB
+
+    struct Block
+    {
+        Block *next;
+    };
+
+    // 其他线程释放的块的归还链表(多生产者压栈，所属线程整体取走)，线程退出后关闭并留给新线程复用
+    struct ReturnList
+    {
+        std::atomic<Block *> head;
+        ReturnList *nextRetired;
+    };
+
+    // 位于返回给调用者的地址之前，保持16字节对齐
+    struct Header
+    {
+        ReturnList *owner; // 为nullptr表示分配时线程的池已析构，释放时直接free
+        size_t capacity;
+    };
+    static const size_t kHeaderSize = 16;
+
+    BufferPool();
+
+    static BufferPool *local();
+    static int sizeClass(size_t size);
+    static Header *header(char *p) { return reinterpret_cast<Header *>(p - kHeaderSize); }
+    static char *allocateBlock(size_t capacity, ReturnList *owner);
+    static void freeBlock(char *p);
+    static Block *closedMarker();
+    // 在其他线程释放：压入分配线程的归还链表，链表已关闭时直接free
+    static void returnToOwner(char *p, ReturnList *owner);
+
+    // 放入本线程的空闲链表，超过每级缓存上限时free
+    void cache(char *p, size_t capacity);
+    // 取回其他线程归还的块
+    void drainReturns();
+
+    static ReturnList *retired_; // 已退出线程关闭的归还链表，新线程复用，避免线程反复创建时泄漏
+
+    Block *freeLists_[kNumClasses];
+    size_t freeCounts_[kNumClasses];
+    ReturnList *returns_;
+    Stats stats_;
+};
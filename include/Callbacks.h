@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 
 class Buffer;
 class TcpConnection;
@@ -12,4 +13,8 @@ using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;
 using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
 using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
-using MessageCallback = std::function<void(const TcpConnectionPtr &, Buffer *, Timestamp)>;
\ No newline at end of file
+using MessageCallback = std::function<void(const TcpConnectionPtr &, Buffer *, Timestamp)>;
+using TimerCallback = std::function<void()>;
+
+// 只读的引用计数数据，可同时排队在多个连接的发送缓冲区中，发送时不拷贝
+using SharedPayload = std::shared_ptr<const std::string>;
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "ChainBuffer.h"
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+
+ChainBuffer::ChainBuffer() : spare_(nullptr), readableBytes_(0)
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+    for (Segment &segment : segments_)
+    {
+        if (segment.chunk != nullptr)
+        {
+            releaseChunk(segment.chunk);
+        }
+    }
+    if (spare_ != nullptr)
+    {
+        releaseChunk(spare_);
+    }
+}
+
+ChainBuffer::Chunk *ChainBuffer::newChunk()
+{
+    Chunk *chunk = spare_;
+    if (chunk != nullptr)
+    {
+        spare_ = nullptr;
+    }
+    else
+    {
+        size_t capacity = 0;
+        chunk = reinterpret_cast<Chunk *>(BufferPool::allocate(sizeof(Chunk), &capacity));
+    }
+    return chunk;
+}
+
+void ChainBuffer::freeChunk(Chunk *chunk)
+{
+    if (spare_ == nullptr)
+    {
+        spare_ = chunk;
+    }
+    else
+    {
+        releaseChunk(chunk);
+    }
+}
+
+void ChainBuffer::releaseChunk(Chunk *chunk)
+{
+    BufferPool::deallocate(reinterpret_cast<char *>(chunk), sizeof(Chunk));
+}
+
+void ChainBuffer::popFront()
+{
+    Segment &head = segments_.front();
+    if (head.chunk != nullptr)
+    {
+        freeChunk(head.chunk);
+    }
+    segments_.pop_front();
+}
+
+void ChainBuffer::append(const char *data, size_t len)
+{
+    readableBytes_ += len;
+    while (len > 0)
+    {
+        if (segments_.empty() || segments_.back().writableBytes() == 0)
+        {
+            Segment segment;
+            segment.chunk = newChunk();
+            segment.data = nullptr;
+            segment.fd = -1;
+            segment.fileOffset = 0;
+            segment.readIndex = 0;
+            segment.writeIndex = 0;
+            segments_.push_back(std::move(segment));
+        }
+        Segment &tail = segments_.back();
+        size_t n = std::min(len, tail.writableBytes());
+        ::memcpy(tail.chunk->data + tail.writeIndex, data, n);
+        tail.writeIndex += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::append(const std::shared_ptr<const void> &owner, const char *data, size_t len)
+{
+    if (len < kMinSharedSize)
+    {
+        append(data, len);
+        return;
+    }
+
+    Segment segment;
+    segment.chunk = nullptr;
+    segment.owner = owner;
+    segment.data = data;
+    segment.fd = -1;
+    segment.fileOffset = 0;
+    segment.readIndex = 0;
+    segment.writeIndex = len;
+    segments_.push_back(std::move(segment));
+    readableBytes_ += len;
+}
+
+void ChainBuffer::appendFile(int fd, off_t offset, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+
+    Segment segment;
+    segment.chunk = nullptr;
+    segment.data = nullptr;
+    segment.fd = fd;
+    segment.fileOffset = offset;
+    segment.readIndex = 0;
+    segment.writeIndex = len;
+    segments_.push_back(std::move(segment));
+    readableBytes_ += len;
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+    if (len >= readableBytes_)
+    {
+        retrieveAll();
+        return;
+    }
+    readableBytes_ -= len;
+    while (len > 0)
+    {
+        Segment &head = segments_.front();
+        size_t n = std::min(len, head.readableBytes());
+        head.readIndex += n;
+        len -= n;
+        if (head.readableBytes() == 0)
+        {
+            popFront();
+        }
+    }
+}
+
+void ChainBuffer::retrieveAll()
+{
+    while (!segments_.empty())
+    {
+        popFront();
+    }
+    readableBytes_ = 0;
+}
+
+void ChainBuffer::shrinkIfEmpty()
+{
+    if (readableBytes_ == 0)
+    {
+        retrieveAll();
+        if (spare_ != nullptr)
+        {
+            releaseChunk(spare_);
+            spare_ = nullptr;
+        }
+    }
+}
+
+std::shared_ptr<const void> ChainBuffer::frontShared(const char **data, size_t *len) const
+{
+    if (segments_.empty() || !segments_.front().owner)
+    {
+        return std::shared_ptr<const void>();
+    }
+    const Segment &head = segments_.front();
+    *data = head.base() + head.readIndex;
+    *len = head.readableBytes();
+    return head.owner;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *saveErrno)
+{
+    if (!segments_.empty() && segments_.front().fd >= 0)
+    {
+        // 文件内容由内核直接从page cache发送，不经过用户态
+        const Segment &head = segments_.front();
+        off_t offset = head.fileOffset + static_cast<off_t>(head.readIndex);
+        ssize_t n = ::sendfile(fd, head.fd, &offset, head.readableBytes());
+        if (n < 0)
+        {
+            *saveErrno = errno;
+        }
+        else if (n == 0)
+        {
+            // 已到文件末尾，剩余部分永远无法发送
+            *saveErrno = ENODATA;
+            n = -1;
+        }
+        return n;
+    }
+
+    struct iovec vec[IOV_MAX];
+    int iovcnt = 0;
+    for (const Segment &segment : segments_)
+    {
+        if (iovcnt == IOV_MAX || segment.fd >= 0)
+        {
+            // 文件段及其后的数据留到下一次发送，保持顺序
+            break;
+        }
+        vec[iovcnt].iov_base = const_cast<char *>(segment.base() + segment.readIndex);
+        vec[iovcnt].iov_len = segment.readableBytes();
+        ++iovcnt;
+    }
+
+    ssize_t n = ::writev(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <deque>
+#include <memory>
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * @brief 分段缓冲区，由段组成的链表，每段是一个固定大小的自有块，或对外部数据(SharedPayload、移入的Buffer等)的引用，或文件的一段
+ * 追加数据时只在尾部新增段，已有数据从不搬移或整体扩容；发送时用writev一次提交多个内存段，文件段用sendfile发送，整体保持追加顺序
+ * 用作TcpConnection的outputBuffer_，大响应不再反复realloc + memmove，广播的同一份数据也无需为每个连接拷贝
+ */
+class ChainBuffer : noncopyable
+{
+public:
+    static const size_t kChunkSize = 16 * 1024; // 每个自有块的大小，恰好是BufferPool的一级
+    static const size_t kMinSharedSize = 512;   // 小于此长度的共享数据直接拷贝，避免为几十字节增加一个段和引用计数操作
+
+    ChainBuffer();
+    ~ChainBuffer();
+
+    // 可读数据总大小
+    size_t readableBytes() const { return readableBytes_; }
+    // 当前段数
+    size_t numSegments() const { return segments_.size(); }
+
+    // 拷贝追加
+    void append(const char *data, size_t len);
+    // 以引用方式追加[data, data + len)，数据发送完之前保持owner的引用，由owner保证数据有效
+    void append(const std::shared_ptr<const void> &owner, const char *data, size_t len);
+    // 追加文件fd中[offset, offset + len)的内容，只记录位置不读取，fd需保持打开直到该段发送完
+    void appendFile(int fd, off_t offset, size_t len);
+
+    // 丢弃前len字节
+    void retrieve(size_t len);
+    void retrieveAll();
+    // 没有数据时把缓存的空闲块也归还给BufferPool
+    void shrinkIfEmpty();
+
+    /**
+     * @brief 头部段为引用的外部数据时返回其owner，data和len返回其未发送的部分，否则返回空
+     * 供MSG_ZEROCOPY发送使用：只有外部数据的生命周期能延长到内核发送完成，自有块在retrieve后会被复用
+     */
+    std::shared_ptr<const void> frontShared(const char **data, size_t *len) const;
+
+    /**
+     * @brief 以writev把最多IOV_MAX个内存段写入fd，遇到文件段为止；头部为文件段时以sendfile发送该段
+     * 返回写入字节数，调用者随后retrieve；文件比登记的长度短(被截断)时返回-1，saveErrno为ENODATA
+     */
+    ssize_t writeFd(int fd, int *saveErrno);
+
+private:
+    struct Chunk
+    {
+        char data[kChunkSize];
+    };
+
+    struct Segment
+    {
+        Chunk *chunk;                      // 自有块，引用外部数据时为nullptr
+        std::shared_ptr<const void> owner; // 引用的外部数据的所有者
+        const char *data;                  // 引用的外部数据
+        int fd;                            // 文件段的文件描述符，其他段为-1
+        off_t fileOffset;                  // 文件段在文件中的起始位置，readIndex/writeIndex相对于此
+        size_t readIndex;
+        size_t writeIndex;
+
+        const char *base() const { return chunk != nullptr ? chunk->data : data; }
+        size_t readableBytes() const { return writeIndex - readIndex; }
+        size_t writableBytes() const { return chunk != nullptr ? kChunkSize - writeIndex : 0; }
+    };
+
+    Chunk *newChunk();
+    void freeChunk(Chunk *chunk);
+    // 归还给BufferPool
+    static void releaseChunk(Chunk *chunk);
+    // 释放头部的段
+    void popFront();
+
+    std::deque<Segment> segments_;
+    Chunk *spare_; // 缓存一个空闲块，避免收发交替时反复访问内存池
+    size_t readableBytes_;
+};
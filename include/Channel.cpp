@@ -7,6 +7,7 @@
 const int Channel::kNoneEvent = 0;                  // 空事件
 const int Channel::kReadEvent = EPOLLIN | EPOLLPRI; // 读事件
 const int Channel::kWriteEvent = EPOLLOUT;          // 写事件
+const int Channel::kEdgeEvent = EPOLLET;            // 边缘触发
 
 // EventLoop: ChannelList Poller
 Channel::Channel(EventLoop *loop, int fd)
@@ -53,7 +54,7 @@ void Channel::update()
 
 void Channel::handleEventWithGuard(Timestamp receiveTime)
 {
-    LOG_INFO("channel handleEvent revents: %d\n", revents_);
+    LOG_DEBUG("channel handleEvent revents: %d\n", revents_);
     // 对端关闭连接，epoll触发EPOLLHUP
     if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN))
     {
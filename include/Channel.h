@@ -62,11 +62,24 @@ public:
         events_ &= kNoneEvent;
         update();
     }
+    // 设置边缘触发(EPOLLET)，在下一次enableReading/enableWriting时随事件一起注册
+    void setEdgeTriggered(bool on)
+    {
+        if (on)
+        {
+            events_ |= kEdgeEvent;
+        }
+        else
+        {
+            events_ &= ~kEdgeEvent;
+        }
+    }
 
     // 返回fd当前的事件状态
     bool isReading() const { return events_ & kReadEvent; }
     bool isWriting() const { return events_ & kWriteEvent; }
-    bool isNoneEvent() const { return events_ == kNoneEvent; }
+    bool isNoneEvent() const { return (events_ & (kReadEvent | kWriteEvent)) == kNoneEvent; }
+    bool isEdgeTriggered() const { return events_ & kEdgeEvent; }
 
     int index() { return index_; }
     void set_index(int idx) { index_ = idx; }
@@ -88,6 +101,7 @@ private:
     static const int kNoneEvent;
     static const int kReadEvent;
     static const int kWriteEvent;
+    static const int kEdgeEvent;
 
     EventLoop *loop_; // 该channel所属的事件循环
     const int fd_;    // fd，Poller监听的对象
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <stddef.h>
+#include <vector>
+
+class Channel;
+
+/**
+ * @brief fd => Channel映射表
+ * fd是由内核分配的小而稠密的整数，直接以fd为下标存放在按需增长的数组中，增删查均无哈希计算和节点分配
+ */
+class ChannelMap
+{
+public:
+    ChannelMap() : count_(0) {}
+
+    Channel *find(int fd) const
+    {
+        return static_cast<size_t>(fd) < channels_.size() ? channels_[fd] : nullptr;
+    }
+
+    void insert(int fd, Channel *channel)
+    {
+        if (static_cast<size_t>(fd) >= channels_.size())
+        {
+            // 按倍数增长，避免fd递增时频繁扩容
+            channels_.resize(std::max(static_cast<size_t>(fd) + 1, channels_.size() * 2), nullptr);
+        }
+        if (channels_[fd] == nullptr)
+        {
+            ++count_;
+        }
+        channels_[fd] = channel;
+    }
+
+    void erase(int fd)
+    {
+        if (static_cast<size_t>(fd) < channels_.size() && channels_[fd] != nullptr)
+        {
+            channels_[fd] = nullptr;
+            --count_;
+        }
+    }
+
+    // 已注册的channel数量
+    size_t size() const { return count_; }
+
+private:
+    std::vector<Channel *> channels_;
+    size_t count_;
+};
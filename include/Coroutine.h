@@ -0,0 +1,324 @@
+#pragma once
+
+/**
+ * 基于C++20协程的EventLoop/TcpConnection接口，仅在以-std=c++20编译且编译器支持协程时可用，
+ * 其余代码仍可按C++11编译
+ *
+ * 用法：
+ * CoTask session(TcpConnectionPtr conn)
+ * {
+ *     CoConnection c(conn);
+ *     for (;;)
+ *     {
+ *         std::string line = co_await c.readUntil("\r\n");
+ *         if (c.closed())
+ *             break;
+ *         c.send(line);
+ *         co_await c.drain();
+ *         co_await coSleep(conn->getLoop(), 10);
+ *     }
+ * }
+ * server.setConnectionCallback([](const TcpConnectionPtr &conn) { if (conn->connected()) session(conn); });
+ */
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "TcpConnection.h"
+#include "noncopyable.h"
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <string>
+
+/**
+ * @brief 协程帧内存池，按64字节分级的空闲链表，每个线程一份
+ * 协程只在所属loop线程中创建、恢复和销毁，因此线程局部即每个loop一份，分配无需加锁
+ */
+class CoFramePool : noncopyable
+{
+public:
+    static const size_t kAlign = 64;
+    static const size_t kMaxPooledSize = 4096; // 更大的帧直接使用operator new
+    static const size_t kMaxFreePerClass = 256;
+
+    static void *allocate(size_t size)
+    {
+        if (size > kMaxPooledSize)
+        {
+            return ::operator new(size);
+        }
+        FreeList &list = local().lists_[sizeClass(size)];
+        if (list.head != nullptr)
+        {
+            Node *node = list.head;
+            list.head = node->next;
+            --list.count;
+            return node;
+        }
+        return ::operator new((sizeClass(size) + 1) * kAlign);
+    }
+
+    static void deallocate(void *p, size_t size)
+    {
+        if (size > kMaxPooledSize)
+        {
+            ::operator delete(p);
+            return;
+        }
+        FreeList &list = local().lists_[sizeClass(size)];
+        if (list.count >= kMaxFreePerClass)
+        {
+            ::operator delete(p);
+            return;
+        }
+        Node *node = static_cast<Node *>(p);
+        node->next = list.head;
+        list.head = node;
+        ++list.count;
+    }
+
+private:
+    static const size_t kNumClasses = kMaxPooledSize / kAlign;
+
+    struct Node
+    {
+        Node *next;
+    };
+    struct FreeList
+    {
+        Node *head = nullptr;
+        size_t count = 0;
+    };
+
+    ~CoFramePool()
+    {
+        for (FreeList &list : lists_)
+        {
+            while (list.head != nullptr)
+            {
+                Node *next = list.head->next;
+                ::operator delete(list.head);
+                list.head = next;
+            }
+        }
+    }
+
+    static size_t sizeClass(size_t size) { return size == 0 ? 0 : (size - 1) / kAlign; }
+
+    static CoFramePool &local()
+    {
+        static thread_local CoFramePool pool;
+        return pool;
+    }
+
+    FreeList lists_[kNumClasses];
+};
+
+/**
+ * @brief 立即开始执行、结束时自行销毁的协程类型，调用者无需持有
+ * 协程在哪个线程被co_await的事件唤醒就在哪个线程继续执行，本文件的awaitable都在所属loop线程中唤醒
+ */
+struct CoTask
+{
+    struct promise_type
+    {
+        CoTask get_return_object() { return CoTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception()
+        {
+            LOG_ERROR("CoTask unhandled exception\n");
+            std::terminate();
+        }
+
+        static void *operator new(size_t size) { return CoFramePool::allocate(size); }
+        static void operator delete(void *p, size_t size) { CoFramePool::deallocate(p, size); }
+    };
+};
+
+/**
+ * @brief 在loop中挂起当前协程delayMs毫秒，由定时器在loop线程中恢复
+ */
+class CoSleepAwaiter
+{
+public:
+    CoSleepAwaiter(EventLoop *loop, int delayMs) : loop_(loop), delayMs_(delayMs) {}
+
+    bool await_ready() const noexcept { return delayMs_ <= 0; }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        loop_->runAfter(delayMs_ / 1000.0, [handle]()
+                        { handle.resume(); });
+    }
+    void await_resume() const noexcept {}
+
+private:
+    EventLoop *loop_;
+    int delayMs_;
+};
+
+inline CoSleepAwaiter coSleep(EventLoop *loop, int delayMs) { return CoSleepAwaiter(loop, delayMs); }
+
+/**
+ * @brief CoConnection与其安装在TcpConnection上的回调共享的状态，回调通过weak_ptr访问，协程结束后回调自动失效
+ */
+struct CoConnectionState
+{
+    enum Mode
+    {
+        kReadN,
+        kReadUntil,
+        kDrain
+    };
+
+    explicit CoConnectionState(const TcpConnectionPtr &c) : conn(c), closed(false), mode(kReadN), count(0) {}
+
+    // 当前等待条件是否已满足
+    bool ready()
+    {
+        if (closed)
+        {
+            return true;
+        }
+        switch (mode)
+        {
+        case kReadN:
+            return conn->inputBuffer()->readableBytes() >= count;
+        case kReadUntil:
+            return findDelim() != nullptr;
+        case kDrain:
+            return !conn->hasPendingOutput();
+        }
+        return true;
+    }
+
+    // 条件满足后取出结果
+    std::string take()
+    {
+        if (closed || mode == kDrain)
+        {
+            return std::string();
+        }
+        Buffer *buf = conn->inputBuffer();
+        size_t len = mode == kReadN ? count : findDelim() - buf->peek() + delim.size();
+        return buf->retrieveAllAsString(len);
+    }
+
+    // loop线程中有数据到达/发送完成/连接关闭时调用，条件满足则直接恢复协程，不经过任何队列
+    void onEvent()
+    {
+        if (waiter && ready())
+        {
+            std::coroutine_handle<> handle = waiter;
+            waiter = nullptr;
+            handle.resume();
+        }
+    }
+
+    const char *findDelim() const
+    {
+        Buffer *buf = conn->inputBuffer();
+        const char *end = buf->peek() + buf->readableBytes();
+        const char *pos = std::search(buf->peek(), end, delim.begin(), delim.end());
+        return pos == end ? nullptr : pos;
+    }
+
+    TcpConnectionPtr conn;
+    bool closed;
+    std::coroutine_handle<> waiter;
+    Mode mode;
+    size_t count;
+    std::string delim;
+};
+
+/**
+ * @brief TcpConnection的协程适配器，需在连接所属loop线程的ConnectionCallback(或由其启动的协程)中构造
+ * 构造后接管该连接的ConnectionCallback/MessageCallback/WriteCompleteCallback，数据到达、发送完成、连接关闭时在loop线程直接恢复等待的协程；
+ * 连接关闭后所有等待立即返回，read/readUntil返回空串，closed()为true；协程结束后连接上再收到的数据直接丢弃
+ */
+class CoConnection : noncopyable
+{
+public:
+    explicit CoConnection(const TcpConnectionPtr &conn) : state_(std::make_shared<CoConnectionState>(conn))
+    {
+        std::weak_ptr<CoConnectionState> weak(state_);
+        conn->setMessageCallback([weak](const TcpConnectionPtr &, Buffer *buf, Timestamp)
+                                 {
+                                     if (auto state = weak.lock())
+                                     {
+                                         state->onEvent();
+                                     }
+                                     else
+                                     {
+                                         buf->retrieveAll();
+                                     } });
+        conn->setWriteCompleteCallback([weak](const TcpConnectionPtr &)
+                                       {
+                                           if (auto state = weak.lock())
+                                           {
+                                               state->onEvent();
+                                           } });
+        conn->setConnectionCallback([weak](const TcpConnectionPtr &c)
+                                    {
+                                        if (auto state = weak.lock())
+                                        {
+                                            state->closed = !c->connected();
+                                            state->onEvent();
+                                        } });
+        state_->closed = !conn->connected();
+    }
+
+    const TcpConnectionPtr &connection() const { return state_->conn; }
+    bool closed() const { return state_->closed; }
+
+    void send(const std::string &data) { state_->conn->send(data); }
+    void shutdown() { state_->conn->shutdown(); }
+
+    /**
+     * @brief 等待条件保存在Awaiter中，co_await时(await_ready)才写入共享的state
+     * 先创建多个Awaiter再依次co_await时，各自的条件互不覆盖
+     */
+    class Awaiter
+    {
+    public:
+        Awaiter(const std::shared_ptr<CoConnectionState> &state, CoConnectionState::Mode mode, size_t count, std::string delim)
+            : state_(state), mode_(mode), count_(count), delim_(std::move(delim))
+        {
+        }
+
+        bool await_ready()
+        {
+            state_->mode = mode_;
+            state_->count = count_;
+            state_->delim = std::move(delim_);
+            return state_->ready();
+        }
+        void await_suspend(std::coroutine_handle<> handle) { state_->waiter = handle; }
+        std::string await_resume() { return state_->take(); }
+
+    private:
+        std::shared_ptr<CoConnectionState> state_;
+        CoConnectionState::Mode mode_;
+        size_t count_;
+        std::string delim_;
+    };
+
+    // 读取恰好n个字节
+    Awaiter read(size_t n) { return Awaiter(state_, CoConnectionState::kReadN, n, std::string()); }
+    // 读取到delim为止(包含delim)
+    Awaiter readUntil(std::string delim) { return Awaiter(state_, CoConnectionState::kReadUntil, 0, std::move(delim)); }
+    // 等待发送缓冲区中的数据全部写入内核，返回空串
+    Awaiter drain() { return Awaiter(state_, CoConnectionState::kDrain, 0, std::string()); }
+
+private:
+    std::shared_ptr<CoConnectionState> state_;
+};
+
+#endif
@@ -2,6 +2,7 @@
 
 #include "Poller.h"
 #include "EpollPoller.h"
+#include "IoUringPoller.h"
 
 Poller *Poller::newDefaultPoller(EventLoop *loop)
 {
@@ -9,6 +10,17 @@ Poller *Poller::newDefaultPoller(EventLoop *loop)
     {
         return nullptr; // 生成poll的实例(未实现)
     }
+    else if (::getenv("MUDUO_USE_IOURING"))
+    {
+        // 生成io_uring的实例，内核不支持时回退到epoll
+        IoUringPoller *poller = new IoUringPoller(loop);
+        if (poller->valid())
+        {
+            return poller;
+        }
+        delete poller;
+        return new EpollPoller(loop);
+    }
     else
     {
         return new EpollPoller(loop); // 生成epoll的实例
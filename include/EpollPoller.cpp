@@ -66,7 +66,7 @@ void EpollPoller::updateChannel(Channel *channel)
         if (index == kNew)
         {
             int fd = channel->fd();
-            channels_[fd] = channel;
+            channels_.insert(fd, channel);
         }
         else // index == kDeleted
         {
@@ -107,7 +107,7 @@ void EpollPoller::removeChannel(Channel *channel)
 
 void EpollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const
 {
-    for (int i < 0; i < numEvents; ++i)
+    for (int i = 0; i < numEvents; ++i)
     {
         Channel *channel = static_cast<Channel *>(events_[i].data.ptr);
         channel->set_revents(events_[i].events);
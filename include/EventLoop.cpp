@@ -2,7 +2,9 @@
 #include "Channel.h"
 #include "Logger.h"
 #include "Poller.h"
+#include "TimerQueue.h"
 
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
 #include <memory>
@@ -15,6 +17,9 @@ __thread EventLoop *t_loopInThisThread = nullptr;
 // 默认Poller IO复用接口超时时间
 const int kPollTimeMs = 10000; // 10s
 
+// 负载统计窗口
+const int64_t kLoadWindowMicroSeconds = 100 * 1000; // 100ms
+
 // 创建wakeupfd 唤醒subLoop处理新的channel
 int createEventfd()
 {
@@ -27,7 +32,7 @@ int createEventfd()
 }
 
 EventLoop::EventLoop()
-    : looping_(false), quit_(false), callingPendingFunctors_(false), threadId_(CurrentThread::tid()), poller_(Poller::newDefaultPoller(this)), wakeupFd_(createEventfd()), wakeupChannel_(new Channel(this, wakeupFd_))
+    : looping_(false), quit_(false), threadId_(CurrentThread::tid()), poller_(Poller::newDefaultPoller(this)), wakeupFd_(createEventfd()), wakeupChannel_(new Channel(this, wakeupFd_)), timerQueue_(new TimerQueue(this)), polling_(false), wakeupPending_(false), busyPollMicroSeconds_(0), metricsEnabled_(false), oldestFunctorTime_(0), loadTracking_(false), busyPermille_(0), numConnections_(0)
 {
     LOG_DEBUG("EventLoop created %p in thread %d\n", this, threadId_);
     if (t_loopInThisThread)
@@ -38,6 +43,10 @@ EventLoop::EventLoop()
     {
         t_loopInThisThread = this;
     }
+
+    // 监听wakeupFd_的读事件，其他线程通过wakeup()唤醒当前loop
+    wakeupChannel_->setReadCallback(std::bind(&EventLoop::handleRead, this));
+    wakeupChannel_->enableReading();
 }
 
 EventLoop::~EventLoop()
@@ -55,14 +64,48 @@ void EventLoop::loop()
 
     LOG_INFO("EventLoop %p start looping\n", this);
 
-    while (!quit)
+    Timestamp lastActiveTime(Timestamp::now()); // 最近一次有事件或回调需要处理的时间
+    // 本次loop()还未poll过，清除初始值(0)或上次loop()留下的时间，首轮迭代不据此判断忙轮询、不统计忙碌时间
+    pollReturnTime_ = Timestamp();
+    int64_t loadWindowStart = lastActiveTime.microSecondsSinceEpoch();
+    int64_t loadWindowBusy = 0; // 当前统计窗口内处理事件和回调的时间
+
+    while (!quit_)
     {
         activeChannels_.clear();
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
-        for (Channel *channel : activeChannels_)
+
+        // 忙轮询模式：距最近一次活动未超过预算时，以0超时poll，不进入睡眠
+        int timeoutMs = 0;
+        bool spinning = busyPollMicroSeconds_ > 0 && pollReturnTime_.valid() &&
+                        pollReturnTime_.microSecondsSinceEpoch() - lastActiveTime.microSecondsSinceEpoch() < busyPollMicroSeconds_;
+        if (!spinning)
+        {
+            // 先声明即将进入poll，再检查队列：与queueInLoop的入队、检查polling_顺序相反，保证两者至少有一方看到对方
+            polling_ = true;
+            timeoutMs = pendingFunctors_.empty() ? kPollTimeMs : 0;
+        }
+        bool metrics = metricsEnabled();
+        bool tracking = loadTracking_.load(std::memory_order_relaxed);
+        Timestamp pollStartTime(metrics || tracking ? Timestamp::now() : Timestamp());
+        if (tracking && pollReturnTime_.valid())
         {
+            // 上一次poll返回到本次poll之间即为上一轮迭代的忙碌时间
+            loadWindowBusy += pollStartTime.microSecondsSinceEpoch() - pollReturnTime_.microSecondsSinceEpoch();
+            updateBusyRatio(pollStartTime.microSecondsSinceEpoch(), &loadWindowStart, &loadWindowBusy);
+        }
+        pollReturnTime_ = poller_->poll(timeoutMs, &activeChannels_);
+        polling_ = false;
+        wakeupPending_ = false;
+
+        Timestamp lastDispatchTime; // 最后一个活跃channel开始处理的时间
+        for (size_t i = 0; i < activeChannels_.size(); ++i)
+        {
+            if (metrics && i + 1 == activeChannels_.size())
+            {
+                lastDispatchTime = Timestamp::now();
+            }
             // 通知channel处理相应事件
-            channel->handleEvent(pollReturnTime_);
+            activeChannels_[i]->handleEvent(pollReturnTime_);
         }
 
         /**
@@ -72,12 +115,53 @@ void EventLoop::loop()
          *
          * mainloop调用queueInLoop将回调传入subloop，queueInLoop通过wakeup唤醒subloop
          */
-        doPendingFunctors();
+        Timestamp callbackEndTime(metrics ? Timestamp::now() : Timestamp());
+        // 先清除再执行，执行期间入队的回调重新记录入队时间；统计关闭时也清除，避免重新开启时读到过期的时间
+        int64_t oldestFunctorTime = oldestFunctorTime_.load(std::memory_order_relaxed) != 0 ? oldestFunctorTime_.exchange(0, std::memory_order_relaxed) : 0;
+        size_t numFunctors = doPendingFunctors();
+
+        if (metrics)
+        {
+            int64_t pollReturn = pollReturnTime_.microSecondsSinceEpoch();
+            int64_t callbackEnd = callbackEndTime.microSecondsSinceEpoch();
+            int64_t loopLag = -1;
+            if (!activeChannels_.empty())
+            {
+                loopLag = lastDispatchTime.microSecondsSinceEpoch() - pollReturn;
+            }
+            if (numFunctors > 0 && oldestFunctorTime != 0)
+            {
+                loopLag = std::max(loopLag, callbackEnd - oldestFunctorTime);
+            }
+            metrics_.recordIteration(pollReturn - pollStartTime.microSecondsSinceEpoch(),
+                                     callbackEnd - pollReturn,
+                                     Timestamp::now().microSecondsSinceEpoch() - callbackEnd,
+                                     loopLag, activeChannels_.size(), numFunctors);
+        }
+
+        if (!activeChannels_.empty() || numFunctors > 0)
+        {
+            lastActiveTime = pollReturnTime_;
+        }
     }
     LOG_INFO("EventLoop %p stop looping.\n", this);
     looping_ = true;
 }
 
+void EventLoop::updateBusyRatio(int64_t now, int64_t *windowStart, int64_t *windowBusy)
+{
+    int64_t elapsed = now - *windowStart;
+    if (elapsed < kLoadWindowMicroSeconds)
+    {
+        return;
+    }
+    // 与上一窗口的值各占一半，平滑瞬时波动
+    int permille = static_cast<int>(std::min<int64_t>(*windowBusy * 1000 / elapsed, 1000));
+    busyPermille_.store((busyPermille_.load(std::memory_order_relaxed) + permille) / 2, std::memory_order_relaxed);
+    *windowStart = now;
+    *windowBusy = 0;
+}
+
 void EventLoop::quit()
 {
     /**
@@ -101,19 +185,25 @@ void EventLoop::runInLoop(Functor cb)
     else
     {
         // 非当前EventLoop中执行cb，需要唤醒其Loop所在线程执行
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
     }
 }
 
 void EventLoop::queueInLoop(Functor cb)
 {
-    std::unique_lock<std::mutex> lock(mutex_);
-    pendingFunctors_.emplace_back(cb);
+    if (metricsEnabled() && oldestFunctorTime_.load(std::memory_order_relaxed) == 0)
+    {
+        // 只有队列中第一个回调需要取时间
+        int64_t expected = 0;
+        oldestFunctorTime_.compare_exchange_strong(expected, Timestamp::now().microSecondsSinceEpoch(), std::memory_order_relaxed);
+    }
+    pendingFunctors_.push(std::move(cb));
 
     /**
-     * 非当前EventLoop或pendingFunctors中有新的回调待处理，通过wakeup唤醒相应的loop线程执行回调
+     * 只有loop线程阻塞在poll中时才需要唤醒，其余情况下loop会在本轮迭代末尾或下一次poll前发现新的回调
+     * 多个线程同时投递时只写一次wakeupFd_
      */
-    if (!isInLoopThread() || callingPendingFunctors_)
+    if (polling_ && !wakeupPending_.exchange(true))
     {
         wakeup();
     }
@@ -140,6 +230,28 @@ void EventLoop::wakeup()
     }
 }
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
 void EventLoop::updateChannel(Channel *channel)
 {
     poller_->updateChannel(channel);
@@ -155,18 +267,27 @@ bool EventLoop::hasChannel(Channel *channel)
     return poller_->hasChannel(channel);
 }
 
-void EventLoop::doPendingFunctors()
+EventLoopMetrics::Snapshot EventLoop::metricsSnapshot() const
 {
-    std::vector<Functor> functors;
-    callingPendingFunctors_ = true;
+    EventLoopMetrics::Snapshot snap;
+    metrics_.snapshot(&snap);
+    snap.threadId = threadId_;
+    return snap;
+}
 
-    std::unique_lock<std::mutex> lock(mutex_);
-    functors.swap(pendingFunctors_);
+bool EventLoop::supportsEdgeTriggered() const
+{
+    return poller_->supportsEdgeTriggered();
+}
 
-    for (const Functor &functor : functors)
-    {
-        functor();
-    }
+void EventLoop::abortNotInLoopThread() const
+{
+    LOG_FATAL("EventLoop %p was created in thread %d, current thread is %d\n", this, threadId_, CurrentThread::tid());
+}
 
-    callingPendingFunctors_ = false;
+size_t EventLoop::doPendingFunctors()
+{
+    // 只执行调用时已入队的回调，回调中新投递的回调留到下一轮(此时poll超时为0)
+    return pendingFunctors_.consumeAll([](Functor &functor)
+                                       { functor(); });
 }
@@ -1,17 +1,22 @@
 #pragma once
 
+#include "Callbacks.h"
 #include "CurrentThread.h"
+#include "EventLoopMetrics.h"
+#include "MpscQueue.h"
+#include "Task.h"
+#include "TimerId.h"
 #include "Timestamp.h"
 #include "noncopyable.h"
 
 #include <atomic>
 #include <functional>
 #include <memory>
-#include <mutex>
 #include <vector>
 
 class Channel;
 class Poller;
+class TimerQueue;
 
 /**
  * @brief 事件循环类，控制Poller，管理Channel
@@ -19,7 +24,7 @@ class Poller;
 class EventLoop : public noncopyable
 {
 public:
-    using Functor = std::function<void()>;
+    using Functor = Task; // 只可移动，常见的小闭包无需堆分配
 
     EventLoop();
     ~EventLoop();
@@ -33,6 +38,28 @@ public:
     // poll返回的时间戳
     Timestamp pollReturnTime() const { return pollReturnTime_; }
 
+    /**
+     * 低延迟模式：最近一次处理事件或回调后的microSeconds微秒内以0超时轮询poll，不进入睡眠，超过预算后恢复阻塞poll
+     * 0表示关闭(默认)，需在loop线程中或loop()开始之前设置(如ThreadInitCallback)
+     */
+    void setBusyPollTime(int microSeconds) { busyPollMicroSeconds_ = microSeconds; }
+
+    // 开启/关闭运行时统计(poll/回调/pendingFunctors耗时等)，线程安全，关闭时每轮迭代只多一次原子读
+    void setMetricsEnabled(bool on) { metricsEnabled_.store(on, std::memory_order_relaxed); }
+    bool metricsEnabled() const { return metricsEnabled_.load(std::memory_order_relaxed); }
+    // 获取统计快照，线程安全
+    EventLoopMetrics::Snapshot metricsSnapshot() const;
+
+    /**
+     * 负载指标，供EventLoopThreadPool选择loop，均可在任意线程读取
+     * busyPermille: 最近约100ms内处理事件和回调所占时间的千分比，需开启setLoadTracking(每轮迭代多一次取时间)
+     * numConnections: 分配到该loop上的连接数，由TcpServer维护
+     */
+    void setLoadTracking(bool on) { loadTracking_.store(on, std::memory_order_relaxed); }
+    int busyPermille() const { return busyPermille_.load(std::memory_order_relaxed); }
+    int numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+    void addConnectionCount(int delta) { numConnections_.fetch_add(delta, std::memory_order_relaxed); }
+
     // 在当前loop中执行cb
     void runInLoop(Functor cb);
 
@@ -42,19 +69,42 @@ public:
     // 通过eventfd唤醒loop所在的线程
     void wakeup();
 
+    // 在time时刻执行cb，线程安全
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    // delay秒后执行cb，线程安全
+    TimerId runAfter(double delay, TimerCallback cb);
+    // 每隔interval秒执行一次cb，线程安全
+    TimerId runEvery(double interval, TimerCallback cb);
+    // 取消定时器，线程安全
+    void cancel(TimerId timerId);
+
     // EventLoop => Poller
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
     bool hasChannel(Channel *channel);
+    // 底层Poller是否支持边缘触发
+    bool supportsEdgeTriggered() const;
 
     // 判断EventLoop对象是否在自己的线程中
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
+    void assertInLoopThread() const
+    {
+        if (!isInLoopThread())
+        {
+            abortNotInLoopThread();
+        }
+    }
 
 private:
     // 给eventfd返回的文件描述符wakeupFd_绑定的事件回调，当有事件发生时(wakeup)，调用handleRead读wakeupFd_的8字节，并唤醒epoll_wait
     void handleRead();
 
-    void doPendingFunctors(); // 执行回调
+    size_t doPendingFunctors(); // 执行回调，返回执行的回调个数
+
+    void abortNotInLoopThread() const;
+
+    // 统计窗口结束时更新busyPermille_
+    void updateBusyRatio(int64_t now, int64_t *windowStart, int64_t *windowBusy);
 
     using ChannelList = std::vector<Channel *>;
 
@@ -72,11 +122,24 @@ private:
 
     std::unique_ptr<Channel> wakeupChannel_;
 
+    std::unique_ptr<TimerQueue> timerQueue_; // 定时器队列，通过timerfd注册到poller_
+
     ChannelList activeChannels_; // 有事件发生的Channel列表，由Poller检测到并填充
 
-    std::atomic_bool callingPendingFunctors_; // 标识当前loop是否有需要执行的回调操作
+    std::atomic_bool polling_; // 标识loop线程是否阻塞在poll中，只有此时queueInLoop才需要写wakeupFd_
+
+    std::atomic_bool wakeupPending_; // 已写wakeupFd_但loop尚未被唤醒，合并多次唤醒
+
+    MpscQueue<Functor> pendingFunctors_; // 存储loop需要执行的所有回调操作，无锁多生产者单消费者队列
+
+    int busyPollMicroSeconds_; // 忙轮询预算(微秒)，0表示不忙轮询
+
+    std::atomic_bool metricsEnabled_; // 是否记录运行时统计
+    EventLoopMetrics metrics_;        // 运行时统计，只由loop线程写入
 
-    std::vector<Functor> pendingFunctors_; // 存储loo需要执行的所有回调操作
+    std::atomic<int64_t> oldestFunctorTime_; // 开启统计时，队列中最早入队的回调的入队时间(微秒)，0表示无
 
-    std::mutex mutex_; // 保护pendingFunctors_线程安全操作
+    std::atomic_bool loadTracking_;     // 是否统计busyPermille_
+    std::atomic_int busyPermille_;      // 最近的忙碌时间千分比
+    std::atomic_int numConnections_;    // 分配到该loop的连接数
 };
@@ -0,0 +1,103 @@
+#include "EventLoopMetrics.h"
+
+LatencyHistogram::LatencyHistogram() : count_(0), sum_(0), max_(0)
+{
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::record(int64_t microSeconds)
+{
+    if (microSeconds < 0)
+    {
+        microSeconds = 0;
+    }
+    int bucket = microSeconds == 0 ? 0 : 64 - __builtin_clzll(static_cast<uint64_t>(microSeconds));
+    if (bucket >= kNumBuckets)
+    {
+        bucket = kNumBuckets - 1;
+    }
+    increase(buckets_[bucket], 1);
+    increase(count_, 1);
+    increase(sum_, static_cast<uint64_t>(microSeconds));
+    if (microSeconds > max_.load(std::memory_order_relaxed))
+    {
+        max_.store(microSeconds, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::snapshot(Snapshot *snap) const
+{
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        snap->buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    snap->count = count_.load(std::memory_order_relaxed);
+    snap->sumMicroSeconds = sum_.load(std::memory_order_relaxed);
+    snap->maxMicroSeconds = max_.load(std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::Snapshot::percentile(double p) const
+{
+    // 各字段分别读取，count可能与桶之和略有出入，以桶之和为准
+    uint64_t total = 0;
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        total += buckets[i];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(total * p / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        seen += buckets[i];
+        if (seen > rank)
+        {
+            return i == 0 ? 0 : (1LL << i) - 1;
+        }
+    }
+    return maxMicroSeconds;
+}
+
+EventLoopMetrics::EventLoopMetrics()
+    : iterations_(0), events_(0), functors_(0), maxEventsPerLoop_(0), lastFunctorBatch_(0), maxFunctorBatch_(0)
+{
+}
+
+void EventLoopMetrics::recordIteration(int64_t pollTime, int64_t callbackTime, int64_t functorTime, int64_t loopLag, size_t numEvents, size_t numFunctors)
+{
+    increase(iterations_, 1);
+    increase(events_, numEvents);
+    increase(functors_, numFunctors);
+    updateMax(maxEventsPerLoop_, numEvents);
+    lastFunctorBatch_.store(numFunctors, std::memory_order_relaxed);
+    updateMax(maxFunctorBatch_, numFunctors);
+
+    pollTime_.record(pollTime);
+    callbackTime_.record(callbackTime);
+    functorTime_.record(functorTime);
+    if (loopLag >= 0)
+    {
+        loopLag_.record(loopLag);
+    }
+}
+
+void EventLoopMetrics::snapshot(Snapshot *snap) const
+{
+    snap->iterations = iterations_.load(std::memory_order_relaxed);
+    snap->events = events_.load(std::memory_order_relaxed);
+    snap->functors = functors_.load(std::memory_order_relaxed);
+    snap->maxEventsPerLoop = maxEventsPerLoop_.load(std::memory_order_relaxed);
+    snap->lastFunctorBatch = lastFunctorBatch_.load(std::memory_order_relaxed);
+    snap->maxFunctorBatch = maxFunctorBatch_.load(std::memory_order_relaxed);
+    pollTime_.snapshot(&snap->pollTime);
+    callbackTime_.snapshot(&snap->callbackTime);
+    functorTime_.snapshot(&snap->functorTime);
+    loopLag_.snapshot(&snap->loopLag);
+}
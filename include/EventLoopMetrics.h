@@ -0,0 +1,105 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * @brief 延迟直方图，按微秒数的log2分桶，第i个桶统计[2^(i-1), 2^i)微秒的样本
+ * 只由loop线程写入，任意线程可读取，写入只使用relaxed原子操作，无锁
+ */
+class LatencyHistogram : noncopyable
+{
+public:
+    static const int kNumBuckets = 26; // 最后一个桶包含所有>=2^24微秒(约16s)的样本
+
+    struct Snapshot
+    {
+        uint64_t buckets[kNumBuckets];
+        uint64_t count;
+        uint64_t sumMicroSeconds;
+        int64_t maxMicroSeconds;
+
+        // 返回百分位数(0~100)所在桶的上界(微秒)
+        int64_t percentile(double p) const;
+    };
+
+    LatencyHistogram();
+
+    void record(int64_t microSeconds);
+    void snapshot(Snapshot *snap) const;
+
+private:
+    // 单写者，load + store即可，避免加锁的read-modify-write指令
+    static void increase(std::atomic<uint64_t> &counter, uint64_t delta)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> buckets_[kNumBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<int64_t> max_;
+};
+
+/**
+ * @brief EventLoop运行时统计，每个EventLoop一份，由EventLoop::loop()在开启统计时每轮迭代更新
+ */
+class EventLoopMetrics : noncopyable
+{
+public:
+    struct Snapshot
+    {
+        pid_t threadId;
+        uint64_t iterations;        // 循环迭代次数
+        uint64_t events;            // 处理的活跃channel总数
+        uint64_t functors;          // 执行的pendingFunctors总数
+        uint64_t maxEventsPerLoop;  // 单次迭代最多的活跃channel数
+        uint64_t lastFunctorBatch;  // 最近一次doPendingFunctors执行的回调数
+        uint64_t maxFunctorBatch;   // 单次doPendingFunctors最多执行的回调数
+        LatencyHistogram::Snapshot pollTime;     // 阻塞在Poller::poll中的时间
+        LatencyHistogram::Snapshot callbackTime; // Channel::handleEvent回调耗时
+        LatencyHistogram::Snapshot functorTime;  // doPendingFunctors耗时
+        /**
+         * 就绪事件和回调从就绪到开始处理的等待时间，每轮有事件或回调时记录一次，取以下两者的较大值：
+         * 最早入队的回调从queueInLoop到doPendingFunctors开始；最后一个活跃channel从poll返回到开始处理
+         * 事件在poll返回前已就绪的时间无法得知，不计入
+         */
+        LatencyHistogram::Snapshot loopLag;
+    };
+
+    EventLoopMetrics();
+
+    // loop线程每轮迭代调用一次，时间均为微秒，loopLag小于0表示本轮没有需要处理的事件和回调
+    void recordIteration(int64_t pollTime, int64_t callbackTime, int64_t functorTime, int64_t loopLag, size_t numEvents, size_t numFunctors);
+
+    void snapshot(Snapshot *snap) const;
+
+private:
+    static void increase(std::atomic<uint64_t> &counter, uint64_t delta)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+    static void updateMax(std::atomic<uint64_t> &counter, uint64_t value)
+    {
+        if (value > counter.load(std::memory_order_relaxed))
+        {
+            counter.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint64_t> iterations_;
+    std::atomic<uint64_t> events_;
+    std::atomic<uint64_t> functors_;
+    std::atomic<uint64_t> maxEventsPerLoop_;
+    std::atomic<uint64_t> lastFunctorBatch_;
+    std::atomic<uint64_t> maxFunctorBatch_;
+
+    LatencyHistogram pollTime_;
+    LatencyHistogram callbackTime_;
+    LatencyHistogram functorTime_;
+    LatencyHistogram loopLag_;
+};
@@ -39,9 +39,12 @@ void EventLoopThread::threadFunc()
         callback_(&loop);
     }
 
-    std::unique_lock<std::mutex> lock(mutex_);
-    loop_ = &loop;
-    cond_.notify_one();
+    {
+        // 只在发布loop_时持锁，loop()期间不能持有，否则startLoop无法从wait返回
+        std::unique_lock<std::mutex> lock(mutex_);
+        loop_ = &loop;
+        cond_.notify_one();
+    }
 
     loop.loop(); // 执行EventLoop的loop()，开启底层Poller的poll()
     std::unique_lock<std::mutex> lock(mutex_);
@@ -19,6 +19,9 @@ public:
 
     ~EventLoopThread();
 
+    // 将loop线程绑定到cpu核心上运行，需在startLoop之前设置
+    void setCpuAffinity(int cpu) { thread_.setCpuAffinity(cpu); }
+
     EventLoop *startLoop();
 
 private:
@@ -2,9 +2,37 @@
 
 #include "EventLoop.h"
 #include "EventLoopThread.h"
+#include "InetAddress.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+// 当前进程允许运行的cpu核心
+static std::vector<int> availableCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    if (::sched_getaffinity(0, sizeof(cpuset), &cpuset) < 0)
+    {
+        LOG_ERROR("sched_getaffinity error: %d\n", errno);
+        return cpus;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &cpuset))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg)
-    : baseLoop_(baseLoop), name_(nameArg), started_(false), numThreads_(0), next_(0)
+    : baseLoop_(baseLoop), name_(nameArg), started_(false), numThreads_(0), next_(0), autoCpuAffinity_(false), strategy_(kRoundRobin), seed_(static_cast<unsigned int>(::time(NULL)))
 {
 }
 
@@ -16,13 +44,27 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 {
     started_ = true;
 
+    std::vector<int> cpus = cpus_;
+    if (cpus.empty() && autoCpuAffinity_)
+    {
+        cpus = availableCpus();
+    }
+
     for (int i = 0; i < numThreads_; ++i)
     {
         char buf[name_.size() + 32];
         snprintf(buf, sizeof(buf), "%s%d", name_.c_str(), i);
         EventLoopThread *t = new EventLoopThread(cb, buf);
+        if (!cpus.empty())
+        {
+            t->setCpuAffinity(cpus[i % cpus.size()]);
+        }
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         loops_.push_back(t->startLoop()); // 底层创建线程，绑定一个新的EventLoop并返回该loop地址
+        if (strategy_ == kPowerOfTwoChoices)
+        {
+            loops_.back()->setLoadTracking(true);
+        }
     }
 
     // 只有一个线程，运行baseLoop
@@ -50,6 +92,59 @@ EventLoop *EventLoopThreadPool::getNextLoop()
     return loop;
 }
 
+EventLoop *EventLoopThreadPool::getNextLoop(const InetAddress &peerAddr)
+{
+    if (loops_.empty())
+    {
+        return baseLoop_;
+    }
+    if (selector_)
+    {
+        return selector_(loops_, peerAddr);
+    }
+
+    size_t n = loops_.size();
+    switch (strategy_)
+    {
+    case kLeastConnections:
+    {
+        EventLoop *loop = loops_[0];
+        for (size_t i = 1; i < n; ++i)
+        {
+            if (loops_[i]->numConnections() < loop->numConnections())
+            {
+                loop = loops_[i];
+            }
+        }
+        return loop;
+    }
+    case kPowerOfTwoChoices:
+    {
+        // b从其余n - 1个loop中抽取，两个样本不会是同一个loop
+        size_t ia = ::rand_r(&seed_) % n;
+        size_t ib = n > 1 ? (ia + 1 + ::rand_r(&seed_) % (n - 1)) % n : ia;
+        EventLoop *a = loops_[ia];
+        EventLoop *b = loops_[ib];
+        if (a->busyPermille() != b->busyPermille())
+        {
+            return a->busyPermille() < b->busyPermille() ? a : b;
+        }
+        return a->numConnections() <= b->numConnections() ? a : b;
+    }
+    case kHashPeerAddress:
+    {
+        // Knuth乘法哈希，只取ip，同一客户端的多个连接落在同一loop；
+        // 乘积的高位才是混合充分的部分，按比例映射到[0, n)而不是取模(取模只用到低位)
+        uint32_t ip = ntohl(peerAddr.getSockAddr()->sin_addr.s_addr);
+        uint32_t hash = ip * 2654435761u;
+        return loops_[(static_cast<uint64_t>(hash) * n) >> 32];
+    }
+    case kRoundRobin:
+    default:
+        return getNextLoop();
+    }
+}
+
 std::vector<EventLoop *> EventLoopThreadPool::getAllLoops()
 {
     if (loops_.empty())
@@ -61,3 +156,21 @@ std::vector<EventLoop *> EventLoopThreadPool::getAllLoops()
         return loops_;
     }
 }
+
+void EventLoopThreadPool::setMetricsEnabled(bool on)
+{
+    for (EventLoop *loop : getAllLoops())
+    {
+        loop->setMetricsEnabled(on);
+    }
+}
+
+std::vector<EventLoopMetrics::Snapshot> EventLoopThreadPool::metricsSnapshot()
+{
+    std::vector<EventLoopMetrics::Snapshot> snapshots;
+    for (EventLoop *loop : getAllLoops())
+    {
+        snapshots.push_back(loop->metricsSnapshot());
+    }
+    return snapshots;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "EventLoopMetrics.h"
 #include "noncopyable.h"
 
 #include <functional>
@@ -9,25 +10,56 @@
 
 class EventLoop;
 class EventLoopThread;
+class InetAddress;
 
 class EventLoopThreadPool : public noncopyable
 {
 public:
     using ThreadInitCallback = std::function<void(EventLoop *)>;
+    // 自定义loop选择策略，参数为所有subLoop和新连接的对端地址
+    using LoopSelector = std::function<EventLoop *(const std::vector<EventLoop *> &, const InetAddress &)>;
+
+    // 新连接分配到subLoop的策略
+    enum LoadBalanceStrategy
+    {
+        kRoundRobin,        // 轮询(默认)
+        kLeastConnections,  // 选择连接数最少的loop
+        kPowerOfTwoChoices, // 随机选两个loop，取负载(忙碌时间，其次连接数)较低者
+        kHashPeerAddress    // 按对端ip哈希，同一客户端固定到同一loop
+    };
 
     EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg);
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
 
+    // 第i个loop线程绑定到cpus[i % cpus.size()]，需在start之前设置
+    void setCpuAffinity(const std::vector<int> &cpus) { cpus_ = cpus; }
+    // 按进程可用的cpu核心依次为每个loop线程绑定一个核心(one loop per core)，需在start之前设置
+    void setAutoCpuAffinity(bool on) { autoCpuAffinity_ = on; }
+
+    // 设置负载均衡策略，需在start之前设置
+    void setLoadBalanceStrategy(LoadBalanceStrategy strategy) { strategy_ = strategy; }
+    // 设置自定义选择策略，优先于setLoadBalanceStrategy
+    void setLoopSelector(const LoopSelector &selector) { selector_ = selector; }
+
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
     // 若工作在多线程中，baseLoop_(mainLoop)以轮询方式分配Channel给subLoop
     EventLoop *getNextLoop();
 
+    // 按负载均衡策略为对端地址为peerAddr的新连接选择subLoop
+    EventLoop *getNextLoop(const InetAddress &peerAddr);
+
     // 获取所有的EventLoop
     std::vector<EventLoop *> getAllLoops();
 
+    // 开启/关闭所有loop的运行时统计
+    void setMetricsEnabled(bool on);
+
+    // 获取所有loop的统计快照，线程安全
+    std::vector<EventLoopMetrics::Snapshot> metricsSnapshot();
+
     // 是否启动
     bool started() const { return started_; }
 
@@ -42,4 +74,9 @@ private:
     int next_;                                              // 新连接到来，选择的EventLoop索引
     std::vector<std::unique_ptr<EventLoopThread>> threads_; // IO线程列表
     std::vector<EventLoop *> loops_;                        // 线程池EventLoop列表和EventLoopThread一一对应
+    std::vector<int> cpus_;                                 // loop线程绑定的cpu核心列表
+    bool autoCpuAffinity_;                                  // 是否自动为每个loop线程绑定一个核心
+    LoadBalanceStrategy strategy_;                          // 新连接分配策略
+    LoopSelector selector_;                                 // 自定义分配策略
+    unsigned int seed_;                                     // kPowerOfTwoChoices使用的随机数状态
 };
\ No newline at end of file
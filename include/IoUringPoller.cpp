@@ -0,0 +1,309 @@
+#include "IoUringPoller.h"
+#include "Channel.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+const int kNew = -1;    // 某个channel还没添加到Poller
+const int kAdded = 1;   // 某个channel已添加到Poller
+const int kDeleted = 2; // 某个channel已从Poller删除
+
+// 非POLL_ADD请求的user_data，完成时直接丢弃
+const uint64_t kTimeoutUserData = ~0ULL;
+const uint64_t kRemoveUserData = ~0ULL - 1;
+
+static uint64_t encodeUserData(int fd, uint32_t gen)
+{
+    return (static_cast<uint64_t>(fd) << 32) | gen;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop), ringfd_(-1), sqRing_(MAP_FAILED), sqRingSize_(0), cqRing_(MAP_FAILED), cqRingSize_(0), sqes_(nullptr), sqesSize_(0)
+{
+    if (!setupRing())
+    {
+        LOG_ERROR("io_uring_setup error: %d \n", errno);
+    }
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    if (sqes_ != nullptr)
+    {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_ != MAP_FAILED)
+    {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    if (ringfd_ >= 0)
+    {
+        ::close(ringfd_);
+    }
+}
+
+bool IoUringPoller::setupRing()
+{
+    io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, kRingEntries, &params));
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+    cqRing_ = singleMmap ? sqRing_ : ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (cqRing_ == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+    char *cq = static_cast<char *>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    ringfd_ = fd;
+    return true;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_DEBUG("func = %s => fd total cout: %lu\n", __FUNCTION__, channels_.size());
+
+    unsigned minComplete = 0;
+    bool cqEmpty = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) == *cqHead_;
+    if (timeoutMs != 0 && cqEmpty)
+    {
+        minComplete = 1;
+        if (timeoutMs > 0)
+        {
+            // 任意一个完成事件或超时都会使该TIMEOUT完成，从而结束等待
+            timeout_.tv_sec = timeoutMs / 1000;
+            timeout_.tv_nsec = (timeoutMs % 1000) * 1000 * 1000;
+            io_uring_sqe *sqe = getSqe();
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uint64_t>(&timeout_);
+            sqe->len = 1;
+            sqe->off = 1;
+            sqe->user_data = kTimeoutUserData;
+        }
+    }
+
+    unsigned toSubmit = *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    int ret = enter(toSubmit, minComplete);
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if (ret < 0 && saveErrno != EINTR)
+    {
+        errno = saveErrno;
+        LOG_ERROR("IoUringPoller::poll() error!");
+    }
+
+    size_t numBefore = activeChannels->size();
+    fillActiveChannels(activeChannels);
+    if (activeChannels->size() > numBefore)
+    {
+        LOG_DEBUG("%lu events happend\n", activeChannels->size() - numBefore);
+    }
+    else
+    {
+        LOG_DEBUG("%s timeout!\n", __FUNCTION__);
+    }
+    return now;
+}
+
+// channel update => EventLoop updateChannel => Poller updateChannel
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    const int index = channel->index();
+    LOG_INFO("func = %s => fd = %d events = %d index = %d\n", __FUNCTION__, channel->fd(), channel->events(), index);
+
+    if (index == kNew || index == kDeleted)
+    {
+        if (index == kNew)
+        {
+            int fd = channel->fd();
+            channels_.insert(fd, channel);
+        }
+        channel->set_index(kAdded);
+        arm(channel);
+    }
+    else
+    {
+        // channel在Poller中已注册，先撤销旧的POLL_ADD，再按新的事件重新提交
+        disarm(channel->fd());
+        if (channel->isNoneEvent())
+        {
+            channel->set_index(kDeleted);
+        }
+        else
+        {
+            arm(channel);
+        }
+    }
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    int fd = channel->fd();
+    channels_.erase(fd);
+
+    LOG_INFO("func = %s => fd = %d\n", __FUNCTION__, fd);
+
+    int index = channel->index();
+    if (index == kAdded)
+    {
+        disarm(fd);
+    }
+    channel->set_index(kNew);
+}
+
+io_uring_sqe *IoUringPoller::getSqe()
+{
+    unsigned tail = *sqTail_;
+    if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) > sqMask_)
+    {
+        // SQ已满，先把已填写的SQE提交给内核
+        enter(tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE), 0);
+    }
+
+    unsigned index = tail & sqMask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    ::memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    // 未使用SQPOLL，内核只在io_uring_enter中读取SQE，此处提前推进tail是安全的
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+int IoUringPoller::enter(unsigned toSubmit, unsigned minComplete)
+{
+    unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    do
+    {
+        ret = static_cast<int>(::syscall(__NR_io_uring_enter, ringfd_, toSubmit, minComplete, flags, nullptr, 0));
+    } while (ret < 0 && errno == EINTR && minComplete == 0);
+    return ret;
+}
+
+void IoUringPoller::arm(Channel *channel)
+{
+    int fd = channel->fd();
+    if (static_cast<size_t>(fd) >= registrations_.size())
+    {
+        registrations_.resize(std::max(static_cast<size_t>(fd) + 1, registrations_.size() * 2), Registration{0, false});
+    }
+    Registration &reg = registrations_[fd];
+    ++reg.gen;
+    reg.armed = true;
+
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = static_cast<uint32_t>(channel->events());
+    sqe->user_data = encodeUserData(fd, reg.gen);
+}
+
+void IoUringPoller::disarm(int fd)
+{
+    if (static_cast<size_t>(fd) >= registrations_.size() || !registrations_[fd].armed)
+    {
+        return;
+    }
+    // 保留gen不清零，避免fd复用后旧的完成事件被误认为新channel的事件
+    Registration &reg = registrations_[fd];
+    reg.armed = false;
+
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = encodeUserData(fd, reg.gen);
+    sqe->user_data = kRemoveUserData;
+}
+
+void IoUringPoller::fillActiveChannels(ChannelList *activeChannels)
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe &cqe = cqes_[head & cqMask_];
+        if (cqe.user_data == kTimeoutUserData || cqe.user_data == kRemoveUserData)
+        {
+            continue;
+        }
+
+        int fd = static_cast<int>(cqe.user_data >> 32);
+        uint32_t gen = static_cast<uint32_t>(cqe.user_data);
+        if (static_cast<size_t>(fd) >= registrations_.size() || !registrations_[fd].armed || registrations_[fd].gen != gen)
+        {
+            continue; // 已被撤销或重新提交的过期事件
+        }
+        registrations_[fd].armed = false;
+
+        if (cqe.res < 0)
+        {
+            if (cqe.res != -ECANCELED)
+            {
+                LOG_ERROR("io_uring poll fd = %d error: %d\n", fd, -cqe.res);
+            }
+            continue;
+        }
+
+        Channel *channel = channels_.find(fd);
+        if (channel == nullptr)
+        {
+            continue;
+        }
+        channel->set_revents(cqe.res);
+        activeChannels->push_back(channel);
+        // POLL_ADD是one-shot，立即重新提交以保持与epoll LT模式一致的语义，该SQE在下一次poll时随其他SQE一起批量提交
+        arm(channel);
+    }
+    __atomic_store_n(cqHead_, tail, __ATOMIC_RELEASE);
+}
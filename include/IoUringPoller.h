@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Poller.h"
+
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief io_uring IO多路复用模块类，继承Poller
+ * 使用IORING_OP_POLL_ADD监听fd事件，updateChannel只生成SQE，所有SQE在下一次poll()中随io_uring_enter一次性批量提交，
+ * 事件掩码与epoll一致(EPOLLIN/EPOLLOUT...)，因此Channel/TcpConnection无需改动
+ */
+class IoUringPoller : public Poller
+{
+public:
+    IoUringPoller(EventLoop *loop);
+    ~IoUringPoller() override;
+
+    // io_uring是否初始化成功(内核不支持时为false，由newDefaultPoller回退至epoll)
+    bool valid() const { return ringfd_ >= 0; }
+
+    // 重写基类Poller的抽象方法
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+
+private:
+    static const unsigned kRingEntries = 1024;
+
+    // fd在ring中的注册状态，gen用于区分已过期的POLL_ADD完成事件
+    struct Registration
+    {
+        uint32_t gen;
+        bool armed;
+    };
+
+    bool setupRing();
+
+    // 获取一个空闲SQE，SQ满时先提交已有SQE
+    io_uring_sqe *getSqe();
+    // 提交SQE并等待至少minComplete个完成事件
+    int enter(unsigned toSubmit, unsigned minComplete);
+
+    // 为channel提交一次one-shot POLL_ADD / 撤销已提交的POLL_ADD
+    void arm(Channel *channel);
+    void disarm(int fd);
+
+    void fillActiveChannels(ChannelList *activeChannels);
+
+    int ringfd_; // io_uring_setup创建的fd
+
+    // SQ/CQ ring映射
+    void *sqRing_;
+    size_t sqRingSize_;
+    void *cqRing_;
+    size_t cqRingSize_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqMask_;
+    unsigned *sqArray_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe *cqes_;
+
+    __kernel_timespec timeout_; // poll超时时间，供IORING_OP_TIMEOUT使用
+
+    std::vector<Registration> registrations_; // 以fd为下标
+};
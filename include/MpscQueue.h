@@ -0,0 +1,163 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <utility>
+
+/**
+ * @brief 无锁多生产者单消费者队列(Vyukov链表队列)
+ * push可在任意线程调用，只需一次原子exchange；empty/consumeAll只能在唯一的消费者线程调用
+ * 节点循环使用：消费者把用完的节点归还到freeList_，生产者一次取走整条链表放入线程局部缓存，稳定状态下push不再分配内存
+ * freeList_最多保留kMaxFreeNodes个节点，突发积压超出的部分直接释放，使缓存的内存有上限
+ */
+template <typename T>
+class MpscQueue : noncopyable
+{
+public:
+    MpscQueue() : head_(new Node()), tail_(head_.load(std::memory_order_relaxed)), freeList_(nullptr), freeCount_(0) {}
+
+    ~MpscQueue()
+    {
+        deleteList(tail_);
+        deleteList(freeList_.load(std::memory_order_acquire));
+    }
+
+    void push(T value)
+    {
+        Node *node = allocNode(std::move(value));
+        // exchange使用seq_cst，与消费者对polling标志的检查构成Dekker式同步
+        Node *prev = head_.exchange(node, std::memory_order_seq_cst);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 仅消费者线程调用
+    bool empty() const { return head_.load(std::memory_order_seq_cst) == tail_; }
+
+    /**
+     * @brief 仅消费者线程调用，依次处理调用时刻已入队的元素，返回处理个数
+     * 处理过程中新入队的元素(包括f自身push的)留到下一次调用，避免回调不断入队导致饿死
+     */
+    template <typename F>
+    size_t consumeAll(F &&f)
+    {
+        Node *last = head_.load(std::memory_order_acquire);
+        size_t count = 0;
+        while (tail_ != last)
+        {
+            Node *next = tail_->next.load(std::memory_order_acquire);
+            for (int spin = 0; next == nullptr && spin < kMaxSpins; ++spin)
+            {
+                // 生产者已完成exchange但尚未链接next，只差一次store，短暂等待
+                cpuRelax();
+                next = tail_->next.load(std::memory_order_acquire);
+            }
+            if (next == nullptr)
+            {
+                // 生产者被抢占，剩余元素留到下一次调用；此时empty()为false，loop不会阻塞在poll上
+                break;
+            }
+            T value(std::move(next->value));
+            freeNode(tail_);
+            tail_ = next;
+            f(value);
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    static const int kMaxSpins = 128;
+    static const int kMaxFreeNodes = 1024;
+
+    struct Node
+    {
+        Node() : next(nullptr) {}
+        explicit Node(T v) : next(nullptr), value(std::move(v)) {}
+
+        std::atomic<Node *> next; // 在队列中指向后继，在空闲链表中指向下一个空闲节点
+        T value;
+    };
+
+    // 生产者线程缓存的空闲节点，同一T类型的所有队列共用，线程退出时释放
+    struct NodeCache
+    {
+        NodeCache() : head(nullptr) {}
+        ~NodeCache()
+        {
+            deleteList(head);
+            head = nullptr;
+        }
+
+        Node *head;
+    };
+
+    static NodeCache &localCache()
+    {
+        static thread_local NodeCache cache;
+        return cache;
+    }
+
+    static void deleteList(Node *node)
+    {
+        while (node != nullptr)
+        {
+            Node *next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+
+    static void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    Node *allocNode(T &&value)
+    {
+        NodeCache &cache = localCache();
+        if (cache.head == nullptr)
+        {
+            // 整体取走，不存在逐个弹出时的ABA问题
+            cache.head = freeList_.exchange(nullptr, std::memory_order_acquire);
+            if (cache.head != nullptr)
+            {
+                // 与消费者的计数不是原子的整体，只作为近似上限
+                freeCount_.store(0, std::memory_order_relaxed);
+            }
+        }
+        Node *node = cache.head;
+        if (node == nullptr)
+        {
+            return new Node(std::move(value));
+        }
+        cache.head = node->next.load(std::memory_order_relaxed);
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->value = std::move(value);
+        return node;
+    }
+
+    // 仅消费者线程调用，此时生产者对node的最后一次访问(链接next)已完成
+    void freeNode(Node *node)
+    {
+        if (freeCount_.load(std::memory_order_relaxed) >= kMaxFreeNodes)
+        {
+            delete node;
+            return;
+        }
+        freeCount_.fetch_add(1, std::memory_order_relaxed);
+        Node *head = freeList_.load(std::memory_order_relaxed);
+        do
+        {
+            node->next.store(head, std::memory_order_relaxed);
+        } while (!freeList_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    std::atomic<Node *> head_;     // 生产者端，最后入队的节点
+    Node *tail_;                   // 消费者端，哨兵节点
+    std::atomic<Node *> freeList_; // 消费者归还的空闲节点
+    std::atomic<int> freeCount_;   // freeList_中的节点数(近似)
+};
@@ -8,8 +8,7 @@ Poller::Poller(EventLoop *loop) : ownerLoop_(loop)
 
 bool Poller::hasChannel(Channel *channel) const
 {
-    auto it = channels_.find(channel->fd());
-    return it != channels_.end() && it->second == channel;
+    return channels_.find(channel->fd()) == channel;
 }
 
 void Poller::assertInLoopThread() const
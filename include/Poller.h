@@ -1,10 +1,10 @@
 #pragma once
 
+#include "ChannelMap.h"
 #include "noncopyable.h"
 #include "Timestamp.h"
 
 #include <vector>
-#include <unordered_map>
 
 class EventLoop;
 class Channel; // Poller类不拥有Channel对象，根据最小化头文件包含原则，头文件中使用前向声明，源文件包含具体头文件
@@ -25,6 +25,9 @@ public:
     virtual void updateChannel(Channel *channel) = 0;
     virtual void removeChannel(Channel *channel) = 0;
 
+    // 是否支持Channel的边缘触发(EPOLLET)模式
+    virtual bool supportsEdgeTriggered() const { return false; }
+
     // 判断channel是否在当前Poller中
     bool hasChannel(Channel *channel) const;
 
@@ -34,7 +37,6 @@ public:
 
 protected:
     // sockfd: channel
-    using ChannelMap = std::unordered_map<int, Channel *>;
     ChannelMap channels_;
 
 private:
@@ -2,11 +2,16 @@
 #include "InetAddress.h"
 #include "Logger.h"
 
+#include <errno.h>
 #include <netinet/tcp.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
 Socket::~Socket()
 {
     ::close(sockfd_);
@@ -73,3 +78,22 @@ void Socket::setKeepAlive(bool on)
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval));
 }
+
+void Socket::setBusyPoll(int microSeconds)
+{
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &microSeconds, sizeof(microSeconds)) < 0)
+    {
+        LOG_ERROR("setBusyPoll sockfd: %d error: %d\n", sockfd_, errno);
+    }
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+    int optval = on ? 1 : 0;
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) < 0)
+    {
+        LOG_ERROR("setZeroCopy sockfd: %d error: %d\n", sockfd_, errno);
+        return false;
+    }
+    return true;
+}
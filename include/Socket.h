@@ -22,6 +22,10 @@ public:
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on);
+    // SO_BUSY_POLL，内核在阻塞读时忙轮询网卡队列的时间(微秒)
+    void setBusyPoll(int microSeconds);
+    // SO_ZEROCOPY，允许之后以MSG_ZEROCOPY发送，内核不支持时返回false
+    bool setZeroCopy(bool on);
 
 private:
     const int sockfd_;
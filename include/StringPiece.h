@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+/**
+ * @brief 只读的字符串视图(指针+长度)，不拥有也不拷贝数据，相当于C++17的std::string_view
+ * 用于从Buffer中查看数据而不分配内存，底层Buffer被修改(retrieve/append)后视图失效
+ */
+class StringPiece
+{
+public:
+    StringPiece() : data_(nullptr), size_(0) {}
+    StringPiece(const char *data, size_t size) : data_(data), size_(size) {}
+    StringPiece(const char *str) : data_(str), size_(::strlen(str)) {}
+    StringPiece(const std::string &str) : data_(str.data()), size_(str.size()) {}
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const char *begin() const { return data_; }
+    const char *end() const { return data_ + size_; }
+    char operator[](size_t i) const { return data_[i]; }
+
+    void removePrefix(size_t n)
+    {
+        data_ += n;
+        size_ -= n;
+    }
+    void removeSuffix(size_t n) { size_ -= n; }
+
+    bool startsWith(const StringPiece &other) const { return size_ >= other.size_ && (other.size_ == 0 || ::memcmp(data_, other.data_, other.size_) == 0); }
+
+    bool operator==(const StringPiece &other) const { return size_ == other.size_ && (size_ == 0 || ::memcmp(data_, other.data_, size_) == 0); }
+    bool operator!=(const StringPiece &other) const { return !(*this == other); }
+
+    std::string toString() const { return std::string(data_, size_); }
+
+private:
+    const char *data_;
+    size_t size_;
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief 只可移动的void()可调用对象，替代std::function<void()>
+ * 不超过kInlineSize字节的闭包(如std::bind(&TcpConnection::connectEstablished, conn))直接存放在对象内部，不分配堆内存；
+ * 更大的闭包退化为堆上存储
+ */
+class Task
+{
+public:
+    static const size_t kInlineSize = 64;
+
+    Task() noexcept : ops_(nullptr) {}
+    Task(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F &&f) : ops_(nullptr)
+    {
+        typedef typename std::decay<F>::type Fn;
+        construct<Fn>(std::forward<F>(f), std::integral_constant<bool, fitsInline<Fn>()>());
+    }
+
+    Task(Task &&other) noexcept : ops_(other.ops_)
+    {
+        if (ops_ != nullptr)
+        {
+            ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            ops_ = other.ops_;
+            if (ops_ != nullptr)
+            {
+                ops_->move(storage_, other.storage_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops_->invoke(storage_); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+private:
+    // 类型擦除后的操作表，每种闭包类型一份
+    struct Ops
+    {
+        void (*invoke)(void *storage);
+        void (*move)(void *dst, void *src); // 移动到dst并析构src
+        void (*destroy)(void *storage);
+    };
+
+    template <typename Fn>
+    static constexpr bool fitsInline()
+    {
+        return sizeof(Fn) <= kInlineSize && alignof(std::max_align_t) % alignof(Fn) == 0 && std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    template <typename Fn>
+    struct InlineOps
+    {
+        static void invoke(void *storage) { (*static_cast<Fn *>(storage))(); }
+        static void move(void *dst, void *src)
+        {
+            Fn *fn = static_cast<Fn *>(src);
+            ::new (dst) Fn(std::move(*fn));
+            fn->~Fn();
+        }
+        static void destroy(void *storage) { static_cast<Fn *>(storage)->~Fn(); }
+        static const Ops ops;
+    };
+
+    template <typename Fn>
+    struct HeapOps
+    {
+        static Fn *&get(void *storage) { return *static_cast<Fn **>(storage); }
+        static void invoke(void *storage) { (*get(storage))(); }
+        static void move(void *dst, void *src) { ::new (dst) Fn *(get(src)); }
+        static void destroy(void *storage) { delete get(storage); }
+        static const Ops ops;
+    };
+
+    template <typename Fn, typename F>
+    void construct(F &&f, std::true_type)
+    {
+        ::new (static_cast<void *>(storage_)) Fn(std::forward<F>(f));
+        ops_ = &InlineOps<Fn>::ops;
+    }
+
+    template <typename Fn, typename F>
+    void construct(F &&f, std::false_type)
+    {
+        ::new (static_cast<void *>(storage_)) Fn *(new Fn(std::forward<F>(f)));
+        ops_ = &HeapOps<Fn>::ops;
+    }
+
+    void reset()
+    {
+        if (ops_ != nullptr)
+        {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+    const Ops *ops_;
+};
+
+template <typename Fn>
+const Task::Ops Task::InlineOps<Fn>::ops = {&Task::InlineOps<Fn>::invoke, &Task::InlineOps<Fn>::move, &Task::InlineOps<Fn>::destroy};
+
+template <typename Fn>
+const Task::Ops Task::HeapOps<Fn>::ops = {&Task::HeapOps<Fn>::invoke, &Task::HeapOps<Fn>::move, &Task::HeapOps<Fn>::destroy};
@@ -6,14 +6,28 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <functional>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <string.h>
 #include <string>
 #include <sys/sendfile.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
     if (loop == nullptr)
@@ -24,8 +38,11 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)
 }
 
 TcpConnection::TcpConnection(EventLoop *loop, const std::string &nameArg, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr)
-    : loop_(CheckLoopNotNull(loop)), name_(nameArg), state_(kConnecting), reading_(true), socket_(new Socket(sockfd)), channel_(new Channel(loop, sockfd)), localAddr_(localAddr), peerAddr_(peerAddr), highWaterMark_(64 * 1024 * 1024) // 64M
+    : loop_(CheckLoopNotNull(loop)), name_(nameArg), state_(kConnecting), reading_(true), edgeTriggered_(false), writeCoalescing_(false), zeroCopy_(false), zeroCopyThreshold_(kDefaultZeroCopyThreshold), zeroCopySeq_(0), socket_(new Socket(sockfd)), channel_(new Channel(loop, sockfd)), localAddr_(localAddr), peerAddr_(peerAddr), highWaterMark_(64 * 1024 * 1024) /* 64M */, inputBuffer_(0)
 {
+    // TcpConnection在baseLoop线程中构造，缓冲区此时不分配内存，在所属subLoop线程中第一次readFd/append时才从该线程的BufferPool分配，
+    // 空闲连接不占缓冲区内存，且绑核时按first-touch落在loop所在的NUMA节点上
+
     // 给当前连接的Channel注册相应的回调函数以及感兴趣的事件
     channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
     channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
@@ -51,7 +68,89 @@ void TcpConnection::send(const std::string &buf)
         }
         else
         {
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+            // buf在返回后可能失效，拷贝一次后移动到loop线程
+            send(std::string(buf));
+        }
+    }
+}
+
+void TcpConnection::send(std::string &&message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread() && message.size() < ChainBuffer::kMinSharedSize)
+        {
+            sendInLoop(message.data(), message.size());
+        }
+        else
+        {
+            send(SharedPayload(std::make_shared<std::string>(std::move(message))));
+        }
+    }
+}
+
+void TcpConnection::send(const Fragment *fragments, size_t count)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendFragmentsInLoop(fragments, count);
+        }
+        else
+        {
+            // 跨线程时片段指向的内存在返回后可能失效，拷贝拼接一次后移动到loop线程
+            size_t total = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                total += fragments[i].len;
+            }
+            std::string message;
+            message.reserve(total);
+            for (size_t i = 0; i < count; ++i)
+            {
+                message.append(static_cast<const char *>(fragments[i].data), fragments[i].len);
+            }
+            send(std::move(message));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer &&buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread() && buf.readableBytes() < ChainBuffer::kMinSharedSize)
+        {
+            sendInLoop(buf.peek(), buf.readableBytes());
+            buf.retrieveAll();
+        }
+        else
+        {
+            std::shared_ptr<Buffer> holder(std::make_shared<Buffer>(std::move(buf)));
+            if (loop_->isInLoopThread())
+            {
+                sendBufferInLoop(holder);
+            }
+            else
+            {
+                loop_->runInLoop(std::bind(&TcpConnection::sendBufferInLoop, shared_from_this(), std::move(holder)));
+            }
+        }
+    }
+}
+
+void TcpConnection::send(const SharedPayload &payload)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendPayloadInLoop(payload);
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&TcpConnection::sendPayloadInLoop, shared_from_this(), payload));
         }
     }
 }
@@ -85,14 +184,43 @@ void TcpConnection::shutdown()
     }
 }
 
+void TcpConnection::setEdgeTriggered(bool on)
+{
+    edgeTriggered_ = on && loop_->supportsEdgeTriggered();
+}
+
+bool TcpConnection::hasPendingOutput() const
+{
+    // 水平触发时写事件只在outputBuffer_非空时注册，但写合并模式下数据在flush前暂存于outputBuffer_而未注册写事件
+    return outputBuffer_.readableBytes() > 0;
+}
+
+void TcpConnection::setZeroCopy(bool on, size_t minBytes)
+{
+    zeroCopyThreshold_ = minBytes;
+    zeroCopy_ = on && socket_->setZeroCopy(true);
+}
+
+void TcpConnection::setBusyPoll(int microSeconds)
+{
+    socket_->setBusyPoll(microSeconds);
+}
+
 void TcpConnection::connectEstablished()
 {
     setState(kConnected);
     channel_->tie(shared_from_this());
+    if (edgeTriggered_)
+    {
+        // 边缘触发模式下EPOLLOUT在整个连接生命周期内只注册一次，之后不再有epoll_ctl MOD
+        channel_->setEdgeTriggered(true);
+        channel_->enableWriting();
+    }
     channel_->enableReading(); // 注册EPOLLIN事件
 
-    // 新连接建立执行回调
-    connectionCallback_(shared_from_this());
+    // 新连接建立执行回调，使用副本调用，回调中可以重新设置连接的回调(如CoConnection)
+    ConnectionCallback cb(connectionCallback_);
+    cb(shared_from_this());
 }
 
 void TcpConnection::connectDestroyed()
@@ -104,17 +232,69 @@ void TcpConnection::connectDestroyed()
         connectionCallback_(shared_from_this());
     }
     channel_->remove(); // 删除channel
+
+    // 在所属loop线程中把缓冲区内存归还给该loop的BufferPool，TcpConnection对象本身可能在其他线程析构
+    inputBuffer_.retrieveAll();
+    inputBuffer_.shrinkIfEmpty();
+    outputBuffer_.retrieveAll();
+    outputBuffer_.shrinkIfEmpty();
+}
+
+void TcpConnection::shrinkIdleInputBuffer()
+{
+    if (inputBuffer_.internalCapacity() > kMaxIdleInputBufferSize)
+    {
+        inputBuffer_.shrinkIfEmpty();
+    }
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+    if (state_ == kDisconnected)
+    {
+        // 边缘触发模式下投递的继续读取回调执行前连接已关闭
+        return;
+    }
     int savedErrno = 0;
     ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    if (n > 0)
+    if (edgeTriggered_)
+    {
+        // 边缘触发模式下必须读到EAGAIN，否则剩余数据不会再次通知
+        // 单次最多读取kMaxEdgeTriggeredReadBytes，避免一个高速连接独占loop
+        size_t total = 0;
+        while (n > 0)
+        {
+            total += static_cast<size_t>(n);
+            if (total >= kMaxEdgeTriggeredReadBytes)
+            {
+                break;
+            }
+            n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+        }
+        if (total > 0)
+        {
+            messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+            shrinkIdleInputBuffer();
+        }
+        if (total >= kMaxEdgeTriggeredReadBytes)
+        {
+            // 尚未读到EAGAIN，不会再有新的边缘通知，排到本轮其他channel和回调之后继续读
+            loop_->queueInLoop(std::bind(&TcpConnection::handleRead, shared_from_this(), receiveTime));
+            return;
+        }
+        if (n < 0 && (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK))
+        {
+            return;
+        }
+    }
+    else if (n > 0)
     {
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        shrinkIdleInputBuffer();
+        return;
     }
-    else if (n == 0)
+
+    if (n == 0)
     {
         // 客户端断开
         handleClose();
@@ -125,21 +305,67 @@ void TcpConnection::handleRead(Timestamp receiveTime)
         errno = savedErrno;
         LOG_ERROR("TcpConnection::handleRead");
         handleError();
+        if (edgeTriggered_ && state_ != kDisconnected)
+        {
+            // 边缘触发模式下不会再收到该连接的读事件，直接关闭，否则连接泄漏
+            handleClose();
+        }
     }
 }
 
 void TcpConnection::handleWrite()
 {
-    if (channel_->isWriting())
+    if (edgeTriggered_)
     {
+        // EPOLLOUT常驻，没有待发送数据时直接返回
+        if (state_ == kDisconnected || outputBuffer_.readableBytes() == 0)
+        {
+            return;
+        }
         int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+        while (outputBuffer_.readableBytes() > 0)
+        {
+            ssize_t n = writeOutputBuffer(&savedErrno);
+            if (n <= 0)
+            {
+                if (n < 0 && savedErrno == ENODATA)
+                {
+                    // writeOutputBuffer已丢弃数据并关闭写端，与水平触发模式一样只半关闭
+                    return;
+                }
+                if (n < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
+                {
+                    LOG_ERROR("TcpConnection::handleWrite");
+                    // 对端已关闭或连接出错，不会再有可写边缘，丢弃待发送数据并关闭连接
+                    outputBuffer_.retrieveAll();
+                    handleError();
+                    handleClose();
+                }
+                return; // 等待下一次EPOLLOUT边缘
+            }
+            outputBuffer_.retrieve(n);
+        }
+        outputBuffer_.shrinkIfEmpty();
+        if (writeCompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        if (state_ == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+    }
+    else if (channel_->isWriting())
+    {
+        int savedErrno = 0;
+        ssize_t n = writeOutputBuffer(&savedErrno);
         if (n > 0)
         {
             outputBuffer_.retrieve(n); // 读取可读区数据并移动下标
             if (outputBuffer_.readableBytes() == 0)
             {
                 channel_->disableWriting();
+                outputBuffer_.shrinkIfEmpty();
                 if (writeCompleteCallback_)
                 {
                     // TcpConnection对象在其对应的subLoop中，向pendingFunctors_中加入回调
@@ -151,7 +377,7 @@ void TcpConnection::handleWrite()
                 }
             }
         }
-        else
+        else if (savedErrno != ENODATA) // ENODATA已由writeOutputBuffer处理
         {
             LOG_ERROR("TcpConnection::handleWrite");
         }
@@ -175,6 +401,12 @@ void TcpConnection::handleClose()
 
 void TcpConnection::handleError()
 {
+    // 开启零拷贝后，错误队列中的完成通知也以EPOLLERR报告
+    if (!zeroCopyPending_.empty())
+    {
+        handleZeroCopyCompletions();
+    }
+
     int optval;
     socklen_t optlen = sizeof(optval);
     int err = 0;
@@ -186,10 +418,24 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
+    if (err == 0 && zeroCopySeq_ > 0)
+    {
+        return;
+    }
     LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d\n", name_.c_str(), err);
 }
 
-void TcpConnection::sendInLoop(const void *data, size_t len)
+void TcpConnection::sendPayloadInLoop(const SharedPayload &payload)
+{
+    sendInLoop(payload->data(), payload->size(), payload);
+}
+
+void TcpConnection::sendBufferInLoop(const std::shared_ptr<Buffer> &buf)
+{
+    sendInLoop(buf->peek(), buf->readableBytes(), buf);
+}
+
+void TcpConnection::sendInLoop(const void *data, size_t len, const std::shared_ptr<const void> &owner)
 {
     ssize_t nwrote = 0;
     size_t remaining = len;
@@ -197,13 +443,22 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
 
     if (state_ == kDisconnected)
     {
+        // 连接已断开(send投递的回调执行前对端关闭)，数据无处可写，也不能再注册写事件
         LOG_ERROR("disconnected, give up writing");
+        return;
     }
 
-    // channel_第一次开始写数据或缓冲区没有待发送数据
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    // channel_第一次开始写数据或缓冲区没有待发送数据，写合并模式下全部留到flushOutput
+    if (!writeCoalescing_ && !hasPendingOutput())
     {
-        nwrote = ::write(channel_->fd(), data, len);
+        if (owner && zeroCopy_ && len >= zeroCopyThreshold_)
+        {
+            nwrote = sendZeroCopy(owner, static_cast<const char *>(data), len);
+        }
+        else
+        {
+            nwrote = ::write(channel_->fd(), data, len);
+        }
         if (nwrote >= 0)
         {
             remaining = len - nwrote;
@@ -236,22 +491,267 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
     {
         // 当前发送缓冲区剩余待发送数据长度
         size_t oldLen = outputBuffer_.readableBytes();
-        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+        if (owner)
         {
-            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+            outputBuffer_.append(owner, static_cast<const char *>(data) + nwrote, remaining);
+        }
+        else
+        {
+            outputBuffer_.append((char *)data + nwrote, remaining);
+        }
+        outputQueued(oldLen);
+    }
+}
+
+void TcpConnection::outputQueued(size_t oldLen)
+{
+    size_t newLen = outputBuffer_.readableBytes();
+    if (newLen >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+    {
+        loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), newLen));
+    }
+    if (writeCoalescing_)
+    {
+        // 本轮第一次写入时安排flush，pendingFunctors在处理完所有活跃Channel之后、下一次poll之前执行
+        // oldLen非0说明已安排过flush，或者正在等待EPOLLOUT由handleWrite发送
+        if (oldLen == 0)
+        {
+            loop_->queueInLoop(std::bind(&TcpConnection::flushOutput, shared_from_this()));
+        }
+        return;
+    }
+    if (!edgeTriggered_ && !channel_->isWriting())
+    {
+        channel_->enableWriting(); // 注册写事件
+    }
+}
+
+void TcpConnection::flushOutput()
+{
+    if (state_ == kDisconnected || outputBuffer_.readableBytes() == 0 || (!edgeTriggered_ && channel_->isWriting()))
+    {
+        // 连接已关闭，已由handleWrite发送，或正在等待EPOLLOUT
+        return;
+    }
+
+    int savedErrno = 0;
+    while (outputBuffer_.readableBytes() > 0)
+    {
+        ssize_t n = writeOutputBuffer(&savedErrno);
+        if (n <= 0)
+        {
+            if (n < 0 && savedErrno == ENODATA)
+            {
+                // 文件被截断，writeOutputBuffer已丢弃数据并关闭写端，发送并未完成，不回调writeComplete
+                return;
+            }
+            if (n < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
+            {
+                LOG_ERROR("TcpConnection::flushOutput");
+                if (savedErrno == EPIPE || savedErrno == ECONNRESET)
+                {
+                    // 对端已关闭，丢弃待发送数据，由读事件处理关闭
+                    outputBuffer_.retrieveAll();
+                    return;
+                }
+            }
+            break;
         }
-        outputBuffer_.append((char *)data + nwrote, remaining);
-        if (!channel_->isWriting())
+        outputBuffer_.retrieve(n);
+    }
+
+    if (outputBuffer_.readableBytes() > 0)
+    {
+        // 内核发送缓冲区已满，剩余数据由handleWrite发送(边缘触发模式下EPOLLOUT常驻)
+        if (!edgeTriggered_)
         {
-            channel_->enableWriting(); // 注册写事件
+            channel_->enableWriting();
         }
+        return;
+    }
+    outputBuffer_.shrinkIfEmpty();
+    if (writeCompleteCallback_)
+    {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if (state_ == kDisconnecting)
+    {
+        shutdownInLoop();
+    }
+}
+
+void TcpConnection::sendFragmentsInLoop(const Fragment *fragments, size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        total += fragments[i].len;
+    }
+    size_t nwrote = 0;
+    bool faultError = false;
+
+    if (state_ == kDisconnected)
+    {
+        // 连接已断开(send投递的回调执行前对端关闭)，数据无处可写，也不能再注册写事件
+        LOG_ERROR("disconnected, give up writing");
+        return;
+    }
+
+    // 没有待发送数据时所有片段一次writev发出
+    if (!writeCoalescing_ && !hasPendingOutput())
+    {
+        struct iovec vec[IOV_MAX];
+        int iovcnt = 0;
+        for (size_t i = 0; i < count && iovcnt < IOV_MAX; ++i)
+        {
+            vec[iovcnt].iov_base = const_cast<void *>(fragments[i].data);
+            vec[iovcnt].iov_len = fragments[i].len;
+            ++iovcnt;
+        }
+        ssize_t n = ::writev(channel_->fd(), vec, iovcnt);
+        if (n >= 0)
+        {
+            nwrote = static_cast<size_t>(n);
+            if (nwrote == total && writeCompleteCallback_)
+            {
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            LOG_ERROR("TcpConnection::sendFragmentsInLoop");
+            if (errno == EPIPE || errno == ECONNRESET)
+            {
+                faultError = true;
+            }
+        }
+    }
+
+    // 跳过已写出的部分，只把各片段未发送的尾部追加到outputBuffer_
+    if (!faultError && nwrote < total)
+    {
+        size_t oldLen = outputBuffer_.readableBytes();
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (nwrote >= fragments[i].len)
+            {
+                nwrote -= fragments[i].len;
+                continue;
+            }
+            outputBuffer_.append(static_cast<const char *>(fragments[i].data) + nwrote, fragments[i].len - nwrote);
+            nwrote = 0;
+        }
+        outputQueued(oldLen);
+    }
+}
+
+ssize_t TcpConnection::sendZeroCopy(const std::shared_ptr<const void> &owner, const char *data, size_t len)
+{
+    ssize_t n = ::send(channel_->fd(), data, len, MSG_ZEROCOPY);
+    if (n < 0 && errno == ENOBUFS)
+    {
+        // 超出optmem限制，本次退化为拷贝发送
+        return ::send(channel_->fd(), data, len, 0);
+    }
+    if (n >= 0)
+    {
+        ZeroCopyPending pending;
+        pending.seq = zeroCopySeq_++;
+        pending.owner = owner;
+        zeroCopyPending_.push_back(std::move(pending));
+    }
+    return n;
+}
+
+ssize_t TcpConnection::writeOutputBuffer(int *savedErrno)
+{
+    ssize_t n = writeOutputBufferOnce(savedErrno);
+    if (n < 0 && *savedErrno == ENODATA)
+    {
+        // 排队的文件在发送完之前被截断，后续字节流已不完整，丢弃剩余数据并关闭写端，由对端感知
+        LOG_ERROR("TcpConnection::writeOutputBuffer [%s] - file truncated, shutting down\n", name_.c_str());
+        outputBuffer_.retrieveAll();
+        if (!edgeTriggered_ && channel_->isWriting())
+        {
+            channel_->disableWriting();
+        }
+        setState(kDisconnecting);
+        socket_->shutdownWrite();
+    }
+    return n;
+}
+
+ssize_t TcpConnection::writeOutputBufferOnce(int *savedErrno)
+{
+    if (zeroCopy_)
+    {
+        const char *data = nullptr;
+        size_t len = 0;
+        std::shared_ptr<const void> owner = outputBuffer_.frontShared(&data, &len);
+        if (owner && len >= zeroCopyThreshold_)
+        {
+            ssize_t n = sendZeroCopy(owner, data, len);
+            if (n < 0)
+            {
+                *savedErrno = errno;
+            }
+            return n;
+        }
+    }
+    return outputBuffer_.writeFd(channel_->fd(), savedErrno);
+}
+
+void TcpConnection::handleZeroCopyCompletions()
+{
+    bool copied = false;
+    char control[128];
+    while (true)
+    {
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (::recvmsg(channel_->fd(), &msg, MSG_ERRQUEUE) < 0)
+        {
+            break; // EAGAIN，错误队列已读空
+        }
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+            const struct sock_extended_err *serr = reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                copied = true;
+            }
+            // 通知表示序号[ee_info, ee_data]的发送已完成，序号按32位回绕比较
+            uint32_t last = serr->ee_data;
+            while (!zeroCopyPending_.empty() && static_cast<int32_t>(last - zeroCopyPending_.front().seq) >= 0)
+            {
+                zeroCopyPending_.pop_front();
+            }
+        }
+    }
+
+    if (copied && zeroCopy_)
+    {
+        // 内核实际做了拷贝，零拷贝只剩额外开销
+        LOG_INFO("TcpConnection::handleZeroCopyCompletions [%s] - kernel copied data, zerocopy disabled\n", name_.c_str());
+        zeroCopy_ = false;
     }
 }
 
 void TcpConnection::shutdownInLoop()
 {
     // outputBuffer_数据全部向外发送完成
-    if (!channel_->isWriting())
+    if (!hasPendingOutput())
     {
         socket_->shutdownWrite();
     }
@@ -263,14 +763,15 @@ void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t count)
     size_t remaining = count;
     bool faultError = false;
 
-    if (state_ == kDisconnecting)
+    if (state_ == kDisconnected)
     {
-        // 表示此时连接已经断开就不需要发送数据了
+        // 表示此时连接已经断开就不需要发送数据了；kDisconnecting时仍发送，shutdown会等待其发送完
         LOG_ERROR("disconnected, give up writing");
         return;
     }
 
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    // 前面没有排队的数据时先直接发送，否则排在已有数据之后，保证顺序
+    if (!writeCoalescing_ && !hasPendingOutput())
     {
         bytesSent = sendfile(socket_->fd(), fd, &offset, remaining);
         if (bytesSent >= 0)
@@ -294,9 +795,14 @@ void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t count)
             }
         }
     }
-    // 处理剩余数据
+    /**
+     * 剩余部分作为文件段排入outputBuffer_，等socket可写时由handleWrite继续sendfile
+     * 不再queueInLoop重试，socket发送缓冲区满时loop可以睡眠在poll上
+     */
     if (!faultError && remaining > 0)
     {
-        loop_->queueInLoop(std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fd, offset, remaining));
+        size_t oldLen = outputBuffer_.readableBytes();
+        outputBuffer_.appendFile(fd, offset, remaining);
+        outputQueued(oldLen);
     }
 }
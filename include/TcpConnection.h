@@ -1,13 +1,17 @@
 #pragma once
 
 #include "Buffer.h"
+#include "ChainBuffer.h"
 #include "Callbacks.h"
 #include "InetAddress.h"
 #include "Timestamp.h"
 #include "noncopyable.h"
 
 #include <atomic>
+#include <deque>
+#include <initializer_list>
 #include <memory>
+#include <stdint.h>
 #include <string>
 
 class Channel;
@@ -21,6 +25,8 @@ class Socket;
 class TcpConnection : public noncopyable, public std::enable_shared_from_this<TcpConnection>
 {
 public:
+    static const size_t kDefaultZeroCopyThreshold = 16 * 1024;
+
     TcpConnection(EventLoop *loop, const std::string &nameArg, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr);
     ~TcpConnection();
 
@@ -31,24 +37,81 @@ public:
 
     bool connected() const { return state_ == kConnected; }
 
-    // 发送数据
+    // 发送数据，跨线程时拷贝一次后按send(std::string&&)处理
     void send(const std::string &buf);
-    // 零拷贝发送函数
+    // 发送右值字符串，跨线程时移动而不拷贝
+    void send(std::string &&message);
+    /**
+     * @brief 发送右值Buffer，移动其内存而不拷贝，未能立即写完的部分以引用方式排队在outputBuffer_中
+     * 适合在工作线程中用Buffer组装的大响应；Buffer的内存随后在loop线程中归还给该线程的BufferPool
+     */
+    void send(Buffer &&buf);
+    /**
+     * @brief 发送共享数据，未能立即写完的部分以引用方式排队，由writev直接从共享内存发送
+     * 同一份payload可以发送给任意多个连接(广播)，每个连接只增加一次引用计数
+     */
+    void send(const SharedPayload &payload);
+
+    // 待发送的数据片段
+    struct Fragment
+    {
+        const void *data;
+        size_t len;
+    };
+    /**
+     * @brief 以一次writev发送多个片段(如协议头+消息体)，无需先拼接；未写完的部分拷贝到outputBuffer_
+     * 在其他线程调用时片段会先拼接拷贝一次再转到loop线程发送
+     */
+    void send(const Fragment *fragments, size_t count);
+    void send(std::initializer_list<Fragment> fragments) { send(fragments.begin(), fragments.size()); }
+    /**
+     * @brief 零拷贝发送文件fd中[offset, offset + count)的内容，与send的数据按调用顺序排队，由sendfile发送
+     * 未能立即发完的部分作为文件段排在outputBuffer_中，可写时(EPOLLOUT)继续发送；fd需保持打开直到发送完成(WriteCompleteCallback)
+     * 文件段的长度计入高水位判断
+     */
     void sendFile(int fd, off_t offset, size_t count);
 
     // 关闭半连接
     void shutdown();
 
+    // 设置连接socket的SO_BUSY_POLL
+    void setBusyPoll(int microSeconds);
+
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
     void setCloseCallback(const CloseCallback &cb) { closeCallback_ = cb; }
+    // 接收缓冲区，只能在loop线程中访问
+    Buffer *inputBuffer() { return &inputBuffer_; }
+    // 是否还有未写入内核的待发送数据(边缘触发和写合并模式下不能用isWriting判断)，只能在loop线程中调用
+    bool hasPendingOutput() const;
+
     void setHighWaterMarkCallback(const HighWaterMarkCallback &cb, size_t highWaterMark)
     {
         highWaterMarkCallback_ = cb;
         highWaterMark_ = highWaterMark;
     }
 
+    /**
+     * @brief 开启MSG_ZEROCOPY发送，只作用于不小于minBytes的以引用方式发送的数据(SharedPayload、send(std::string&&)、send(Buffer&&))
+     * payload的引用保持到内核通过socket错误队列通知发送完成；更小的数据拷贝更快，仍走普通路径；
+     * 内核报告数据实际被拷贝(如回环网卡)时自动关闭。需在connectEstablished之前或ConnectionCallback中设置
+     */
+    void setZeroCopy(bool on, size_t minBytes = kDefaultZeroCopyThreshold);
+    bool zeroCopy() const { return zeroCopy_; }
+
+    /**
+     * @brief 写合并：send不再立即write，数据先追加到outputBuffer_，在本轮事件循环处理完活跃连接后统一以writev发出
+     * 一次MessageCallback中多次send(如流水线请求的多个响应)只产生一次系统调用，也不会拆成多个小TCP报文
+     * 代价是数据推迟到本轮迭代结束才发送；只能在loop线程中或connectEstablished之前设置
+     */
+    void setWriteCoalescing(bool on) { writeCoalescing_ = on; }
+    bool writeCoalescing() const { return writeCoalescing_; }
+
+    // 边缘触发模式，需在connectEstablished之前设置，Poller不支持时忽略
+    void setEdgeTriggered(bool on);
+    bool edgeTriggered() const { return edgeTriggered_; }
+
     // 建立连接
     void connectEstablished();
 
@@ -56,6 +119,10 @@ public:
     void connectDestroyed();
 
 private:
+    static const size_t kMaxIdleInputBufferSize = 64 * 1024;
+    // 边缘触发模式下单次读事件最多读取的字节数，超出部分留到本轮迭代末尾继续读
+    static const size_t kMaxEdgeTriggeredReadBytes = 256 * 1024;
+
     enum StateE
     {
         kDisconnected, // 已经断开连接
@@ -65,12 +132,31 @@ private:
     };
     void setState(StateE state) { state_ = state; }
 
+    // 突发流量使inputBuffer_扩大到超过kMaxIdleInputBufferSize时，数据处理完后归还内存
+    void shrinkIdleInputBuffer();
+
     void handleRead(Timestamp receiveTime);
     void handleWrite();
     void handleClose();
     void handleError();
 
-    void sendInLoop(const void *data, size_t len);
+    // owner非空时data指向owner持有的数据，剩余部分以引用方式排队
+    void sendInLoop(const void *data, size_t len, const std::shared_ptr<const void> &owner = std::shared_ptr<const void>());
+    void sendPayloadInLoop(const SharedPayload &payload);
+    void sendBufferInLoop(const std::shared_ptr<Buffer> &buf);
+    void sendFragmentsInLoop(const Fragment *fragments, size_t count);
+    // 数据追加到outputBuffer_后调用：跨过高水位时回调，并注册写事件(写合并模式下安排flushOutput)
+    void outputQueued(size_t oldLen);
+    // 写合并模式下在本轮迭代末尾发送outputBuffer_
+    void flushOutput();
+    // 以MSG_ZEROCOPY发送owner持有的[data, data + len)，成功时记录待完成的引用
+    ssize_t sendZeroCopy(const std::shared_ptr<const void> &owner, const char *data, size_t len);
+    // 发送outputBuffer_，排队的文件被截断时丢弃剩余数据并关闭写端，返回-1且*savedErrno为ENODATA，调用者无需再处理
+    ssize_t writeOutputBuffer(int *savedErrno);
+    // 发送一次outputBuffer_，头部为足够大的共享数据时走零拷贝
+    ssize_t writeOutputBufferOnce(int *savedErrno);
+    // 读取socket错误队列中的零拷贝完成通知，释放对应数据
+    void handleZeroCopyCompletions();
     void shutdownInLoop();
     void sendFileInLoop(int fd, off_t offset, size_t count);
 
@@ -78,7 +164,19 @@ private:
     EventLoop *loop_;
     const std::string name_;
     std::atomic_int state_;
-    bool reading_; // 连接是否在监听读事件
+    bool reading_;         // 连接是否在监听读事件
+    bool edgeTriggered_;   // 是否工作在EPOLLET模式，读写均需处理到EAGAIN
+    bool writeCoalescing_; // 是否合并一轮迭代内的send
+
+    struct ZeroCopyPending
+    {
+        uint32_t seq; // 内核为每次成功的MSG_ZEROCOPY发送分配的序号
+        std::shared_ptr<const void> owner;
+    };
+    bool zeroCopy_;
+    size_t zeroCopyThreshold_;
+    uint32_t zeroCopySeq_;
+    std::deque<ZeroCopyPending> zeroCopyPending_; // 内核尚未发送完成的数据
 
     std::unique_ptr<Socket> socket_;
     std::unique_ptr<Channel> channel_;
@@ -94,5 +192,5 @@ private:
     size_t highWaterMark_;                        // 高水位阈值
 
     Buffer inputBuffer_;  // 接收数据缓冲区
-    Buffer outputBuffer_; // 发送数据缓冲区
+    ChainBuffer outputBuffer_; // 发送数据缓冲区，分段存储，以writev发送
 };
\ No newline at end of file
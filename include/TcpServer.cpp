@@ -3,6 +3,7 @@
 #include "TcpConnection.h"
 
 #include <functional>
+#include <future>
 #include <string.h>
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
@@ -15,26 +16,86 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)
 }
 
 TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg, Option option)
-    : loop_(CheckLoopNotNull(loop)), ipPort_(listenAddr.toIpPort()), name_(nameArg), acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)), threadPool_(new EventLoopThreadPool(loop, name_)), connectionCallback_(), messageCallback_(), nextConnId_(1), started_()
+    : loop_(CheckLoopNotNull(loop)), listenAddr_(listenAddr), ipPort_(listenAddr.toIpPort()), name_(nameArg), option_(option), acceptor_(option == kReusePortMultiAcceptor ? nullptr : new Acceptor(loop, listenAddr, option == kReusePort)), threadPool_(new EventLoopThreadPool(loop, name_)), connectionCallback_(), messageCallback_(), started_(), nextConnId_(1), edgeTriggered_(false), writeCoalescing_(false), socketBusyPollMicroSeconds_(0), zeroCopy_(false), zeroCopyThreshold_(TcpConnection::kDefaultZeroCopyThreshold), acceptBatchSize_(Acceptor::kDefaultAcceptBatchSize), numComputeThreads_(0)
 {
     // 当有新连接时，Acceptor类中绑定的acceptChannel_会有读事件发生，执行handleRead()调用TcpServer::newConnection回调
-    acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+    if (acceptor_)
+    {
+        acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+        acceptor_->setAcceptBatchCallback(std::bind(&TcpServer::dispatchPendingConnections, this));
+    }
+}
+
+// 在subloop中依次建立一批连接
+static void connectEstablishedBatch(const std::vector<TcpConnectionPtr> &conns)
+{
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        conn->connectEstablished();
+    }
 }
 
 TcpServer::~TcpServer()
 {
-    for (auto &item : connections_)
+    // 先执行完计算任务，它们可能还会向subloop投递结果
+    if (computePool_)
+    {
+        computePool_->stop();
+    }
+
+    // 先停止接收新连接：subloop的Acceptor需在其所属loop线程中析构(从Poller中移除channel)，此时线程池尚未销毁
+    // 析构返回后该loop不会再向connections_加入连接
+    std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+    for (size_t i = 0; i < loopAcceptors_.size(); ++i)
+    {
+        EventLoop *ioLoop = loops[i];
+        if (ioLoop->isInLoopThread())
+        {
+            loopAcceptors_[i].reset();
+        }
+        else
+        {
+            std::promise<void> done;
+            Acceptor *acceptor = loopAcceptors_[i].release();
+            ioLoop->runInLoop([acceptor, &done]()
+                              { delete acceptor;
+                                done.set_value(); });
+            done.get_future().wait();
+        }
+    }
+
+    // kReusePortMultiAcceptor时subloop仍可能并发移除连接，在锁内整体取出后再遍历
+    ConnectionMap connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections.swap(connections_);
+    }
+    for (auto &item : connections)
     {
         TcpConnectionPtr conn(item.second);
         item.second.reset(); // 原始智能指针复位，让栈空间的TcpConnectionPtr conn指向该对象 当conn离开其作用域就释放智能指针指向的对象
 
         conn->getLoop()->runInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
     }
+
+    // kReusePortMultiAcceptor时subloop直接调用removeConnectionInLoop访问本对象，等各subloop执行完正在进行的关闭和上面投递的回调再析构成员
+    for (size_t i = 0; i < loopAcceptors_.size(); ++i)
+    {
+        EventLoop *ioLoop = loops[i];
+        if (!ioLoop->isInLoopThread())
+        {
+            std::promise<void> done;
+            ioLoop->queueInLoop([&done]()
+                                { done.set_value(); });
+            done.get_future().wait();
+        }
+    }
 }
 
 void TcpServer::setThreadNum(int numThreads)
 {
-    threadPool_->setThreadNum(numThreads_);
+    numThreads_ = numThreads;
+    threadPool_->setThreadNum(numThreads);
 }
 
 void TcpServer::start()
@@ -43,17 +104,70 @@ void TcpServer::start()
     if (started_.fetch_add(1) == 0)
     {
         threadPool_->start(threadInitCallback_); // 启动底层loop线程池
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        if (numComputeThreads_ != 0)
+        {
+            computePool_.reset(new WorkStealingPool(name_ + "Compute"));
+            computePool_->start(numComputeThreads_);
+        }
+        if (option_ == kReusePortMultiAcceptor)
+        {
+            // 每个loop绑定一个SO_REUSEPORT监听socket，accept后直接在该loop上建立连接，不再经过baseloop
+            for (EventLoop *ioLoop : threadPool_->getAllLoops())
+            {
+                Acceptor *acceptor = new Acceptor(ioLoop, listenAddr_, true);
+                acceptor->setNewConnectionCallback(std::bind(&TcpServer::establishConnection, this, ioLoop, std::placeholders::_1, std::placeholders::_2));
+                acceptor->setAcceptBatchSize(acceptBatchSize_);
+                loopAcceptors_.push_back(std::unique_ptr<Acceptor>(acceptor));
+                ioLoop->runInLoop(std::bind(&Acceptor::listen, acceptor));
+            }
+        }
+        else
+        {
+            acceptor_->setAcceptBatchSize(acceptBatchSize_);
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        }
     }
 }
 
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
 {
-    // 获取下一个subloop
-    EventLoop *ioLoop = threadPool_->getNextLoop();
+    // 按负载均衡策略获取subloop
+    EventLoop *ioLoop = threadPool_->getNextLoop(peerAddr);
+    // 先暂存，本轮accept结束后每个subloop只投递一次回调
+    pendingConnections_[ioLoop].push_back(createConnection(ioLoop, sockfd, peerAddr));
+}
+
+void TcpServer::dispatchPendingConnections()
+{
+    for (auto &item : pendingConnections_)
+    {
+        std::vector<TcpConnectionPtr> &conns = item.second;
+        if (conns.empty())
+        {
+            continue;
+        }
+        if (conns.size() == 1)
+        {
+            item.first->runInLoop(std::bind(&TcpConnection::connectEstablished, conns[0]));
+        }
+        else
+        {
+            item.first->runInLoop(std::bind(&connectEstablishedBatch, std::move(conns)));
+        }
+        conns.clear();
+    }
+}
+
+void TcpServer::establishConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
+    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, createConnection(ioLoop, sockfd, peerAddr)));
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
+    ioLoop->addConnectionCount(1);
     char buf[64] = {0};
-    snprintf(buf, sizeof(buf), "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
+    snprintf(buf, sizeof(buf), "-%s#%d", ipPort_.c_str(), nextConnId_.fetch_add(1));
     std::string connName = name_ + buf;
 
     LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s\n", name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
@@ -70,21 +184,41 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
     InetAddress localAddr(local);
     // 把新连接sockfd打包成TcpConnection
     TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
-    connections_[connName] = conn;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_[connName] = conn;
+    }
 
     // 用户在TcpServer中设置，传给TcpConnection
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    conn->setWriteCoalescing(writeCoalescing_);
+    if (socketBusyPollMicroSeconds_ > 0)
+    {
+        conn->setBusyPoll(socketBusyPollMicroSeconds_);
+    }
+    if (zeroCopy_)
+    {
+        conn->setZeroCopy(true, zeroCopyThreshold_);
+    }
 
     conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
-
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    return conn;
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr &conn)
 {
-    loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    if (option_ == kReusePortMultiAcceptor)
+    {
+        // 连接由subloop自己接收和管理，直接在当前subloop中移除
+        removeConnectionInLoop(conn);
+    }
+    else
+    {
+        loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    }
 }
 
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
@@ -92,7 +226,15 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
     LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s\n",
              name_.c_str(), conn->name().c_str());
 
-    connections_.erase(conn->name());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (connections_.erase(conn->name()) == 0)
+        {
+            // 已被~TcpServer取走，由其负责销毁
+            return;
+        }
+    }
     EventLoop *ioLoop = conn->getLoop();
+    ioLoop->addConnectionCount(-1);
     ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
 }
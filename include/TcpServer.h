@@ -7,13 +7,16 @@
 #include "EventLoopThreadPool.h"
 #include "InetAddress.h"
 #include "TcpConnection.h"
+#include "WorkStealingPool.h"
 #include "noncopyable.h"
 
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 /**
  * @brief Tcp服务类
@@ -25,8 +28,9 @@ public:
 
     enum Option
     {
-        kNoReusePort, // 不允许重用本地端口
-        kReusePort    // 允许重用本地端口
+        kNoReusePort,           // 不允许重用本地端口
+        kReusePort,             // 允许重用本地端口
+        kReusePortMultiAcceptor // 每个subloop各自持有一个SO_REUSEPORT监听socket，由内核分发新连接，连接直接在接收它的loop上建立
     };
 
     TcpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg, Option option = kNoReusePort);
@@ -40,6 +44,36 @@ public:
     // 设置subloop个数
     void setThreadNum(int numThreads);
 
+    // 新连接分配到subloop的策略，需在start之前设置
+    void setLoadBalanceStrategy(EventLoopThreadPool::LoadBalanceStrategy strategy) { threadPool_->setLoadBalanceStrategy(strategy); }
+
+    // subloop线程池，可用于获取各loop的运行时统计，start之后有效
+    std::shared_ptr<EventLoopThreadPool> threadPool() const { return threadPool_; }
+
+    // 新连接使用EPOLLET边缘触发模式，需在start之前设置
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+
+    // 新连接开启写合并(见TcpConnection::setWriteCoalescing)，需在start之前设置
+    void setWriteCoalescing(bool on) { writeCoalescing_ = on; }
+
+    // 新连接设置SO_BUSY_POLL(微秒)，0表示不设置；subloop的忙轮询通过ThreadInitCallback中EventLoop::setBusyPollTime开启
+    void setSocketBusyPoll(int microSeconds) { socketBusyPollMicroSeconds_ = microSeconds; }
+
+    // 新连接开启MSG_ZEROCOPY发送(见TcpConnection::setZeroCopy)，需在start之前设置
+    void setZeroCopy(bool on, size_t minBytes = TcpConnection::kDefaultZeroCopyThreshold)
+    {
+        zeroCopy_ = on;
+        zeroCopyThreshold_ = minBytes;
+    }
+
+    // 每次监听socket可读时最多accept的连接数，需在start之前设置
+    void setAcceptBatchSize(int n) { acceptBatchSize_ = n; }
+
+    // 计算线程池的线程数，需在start之前设置；0表示不创建(默认)，负数表示使用可用cpu核心数
+    void setComputeThreadNum(int numThreads) { numComputeThreads_ = numThreads; }
+    // 计算线程池，start之后有效，未开启时为nullptr；在MessageCallback中通过submit(conn->getLoop(), work, done)卸载CPU密集的处理
+    WorkStealingPool *computePool() const { return computePool_.get(); }
+
     /**
      * 若没有监听，就启动服务器(监听)
      * 多次调用无副作用
@@ -49,6 +83,12 @@ public:
 
 private:
     void newConnection(int sockfd, const InetAddress &peerAddr);
+    // baseloop一轮accept结束，把暂存的新连接按subloop批量分发
+    void dispatchPendingConnections();
+    // kReusePortMultiAcceptor时subloop直接在本loop建立连接
+    void establishConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    // 为sockfd创建属于ioLoop的TcpConnection并加入connections_
+    TcpConnectionPtr createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
     void removeConnection(const TcpConnectionPtr &conn);
     void removeConnectionInLoop(const TcpConnectionPtr &conn);
 
@@ -57,10 +97,12 @@ private:
 private:
     EventLoop *loop_; // baseLoop
 
+    const InetAddress listenAddr_;
     const std::string ipPort_;
     const std::string name_;
+    const Option option_;
 
-    std::unique_ptr<Acceptor> acceptor_; // 运行在baseloop 监听新连接
+    std::unique_ptr<Acceptor> acceptor_; // 运行在baseloop 监听新连接，kReusePortMultiAcceptor时为空
 
     std::shared_ptr<EventLoopThreadPool> threadPool_; // one loop per thread
 
@@ -71,6 +113,22 @@ private:
     ThreadInitCallback threadInitCallback_; // loop线程初始化回调
     int numThreads_;                        // 线程数量
     std::atomic_int started_;
-    int nextConnId_;
+    std::atomic_int nextConnId_;
+    bool edgeTriggered_;             // 新连接是否使用边缘触发模式
+    bool writeCoalescing_;           // 新连接是否合并每轮迭代的写
+    int socketBusyPollMicroSeconds_; // 新连接的SO_BUSY_POLL
+    bool zeroCopy_;                  // 新连接是否开启MSG_ZEROCOPY
+    size_t zeroCopyThreshold_;
+    int acceptBatchSize_;
+    int numComputeThreads_;
     ConnectionMap connections_; // 所有连接
+    std::mutex mutex_;          // kReusePortMultiAcceptor时多个subloop并发增删连接，保护connections_
+
+    // baseloop本轮accept到、尚未分发给subloop的连接，只在baseloop中访问
+    std::unordered_map<EventLoop *, std::vector<TcpConnectionPtr>> pendingConnections_;
+
+    // 声明在threadPool_之后，先于subloop析构，保证任务投递结果时loop仍然有效
+    std::unique_ptr<WorkStealingPool> computePool_;
+
+    std::vector<std::unique_ptr<Acceptor>> loopAcceptors_; // kReusePortMultiAcceptor时每个loop各自的Acceptor，与getAllLoops()一一对应
 };
\ No newline at end of file
@@ -1,12 +1,15 @@
 #include "Thread.h"
 #include "CurrentThread.h"
+#include "Logger.h"
 
+#include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
 
 std::atomic_int Thread::numCreated_(0);
 
 Thread::Thread(ThreadFunc func, const std::string &name)
-    : started_(false), joined_(false), tid_(0), func_(std::move(func)), name_(name)
+    : started_(false), joined_(false), tid_(0), func_(std::move(func)), name_(name), cpu_(-1)
 {
     setDefaultName();
 }
@@ -27,6 +30,7 @@ void Thread::start()
     sem_init(&sem, false, 0);
     thread_ = std::shared_ptr<std::thread>(new std::thread([&]()
                                                            { tid_ = CurrentThread::tid();
+                                                        initInThread();
                                                         sem_post(&sem);
                                                     func_(); }));
     // 等待上面创建的线程tid值
@@ -49,3 +53,22 @@ void Thread::setDefaultName()
         name_ = buf;
     }
 }
+
+void Thread::initInThread()
+{
+    // 线程名最长15个字符，便于在top/perf中区分各个loop线程
+    std::string shortName = name_.substr(0, 15);
+    ::pthread_setname_np(::pthread_self(), shortName.c_str());
+
+    if (cpu_ >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu_, &cpuset);
+        int err = ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuset), &cpuset);
+        if (err != 0)
+        {
+            LOG_ERROR("Thread %s set cpu affinity %d error: %d\n", name_.c_str(), cpu_, err);
+        }
+    }
+}
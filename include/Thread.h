@@ -17,6 +17,10 @@ public:
     explicit Thread(ThreadFunc, const std::string &name = std::string());
     ~Thread();
 
+    // 将线程绑定到cpu核心上运行，需在start之前设置，-1表示不绑定
+    void setCpuAffinity(int cpu) { cpu_ = cpu; }
+    int cpuAffinity() const { return cpu_; }
+
     // 创建线程
     void start();
     // 阻塞等待线程结束
@@ -29,6 +33,8 @@ public:
 
 private:
     void setDefaultName();
+    // 在新线程中执行：设置线程名(pthread_setname_np)和cpu亲和性
+    void initInThread();
 
     bool started_;
     bool joined_;
@@ -36,5 +42,6 @@ private:
     pid_t tid_;       // 线程创建时绑定
     ThreadFunc func_; // 线程回调函数
     std::string name_;
+    int cpu_; // 绑定的cpu核心，-1表示不绑定
     static std::atomic_int numCreated_;
 };
\ No newline at end of file
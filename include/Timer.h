@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Callbacks.h"
+#include "Timestamp.h"
+#include "noncopyable.h"
+
+#include <atomic>
+#include <stdint.h>
+
+class TimerList;
+
+/**
+ * @brief 定时器类，记录到期时间、回调及重复间隔，同时作为时间轮槽位中侵入式双向链表的节点
+ */
+class Timer : noncopyable
+{
+public:
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb)), expiration_(when), interval_(interval), repeat_(interval > 0.0), sequence_(++s_numCreated_), list_(nullptr), prev_(nullptr), next_(nullptr)
+    {
+    }
+
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复定时器以now为基准计算下一次到期时间
+    void restart(Timestamp now);
+
+    static int64_t numCreated() { return s_numCreated_; }
+
+private:
+    friend class TimerList;
+
+    const TimerCallback callback_;
+    Timestamp expiration_;
+    const double interval_; // 重复间隔(秒)，<=0表示一次性定时器
+    const bool repeat_;
+    const int64_t sequence_; // 全局唯一序号，用于识别TimerId
+
+    TimerList *list_; // 当前所在的时间轮槽位，不在时间轮中时为nullptr
+    Timer *prev_;
+    Timer *next_;
+
+    static std::atomic<int64_t> s_numCreated_;
+};
+
+/**
+ * @brief 时间轮槽位，侵入式双向链表，插入和删除均为O(1)
+ */
+class TimerList
+{
+public:
+    TimerList() : head_(nullptr) {}
+
+    bool empty() const { return head_ == nullptr; }
+
+    void push(Timer *timer)
+    {
+        timer->list_ = this;
+        timer->prev_ = nullptr;
+        timer->next_ = head_;
+        if (head_ != nullptr)
+        {
+            head_->prev_ = timer;
+        }
+        head_ = timer;
+    }
+
+    // 将timer从其所在的槽位中摘除
+    static void unlink(Timer *timer)
+    {
+        TimerList *list = timer->list_;
+        if (timer->prev_ != nullptr)
+        {
+            timer->prev_->next_ = timer->next_;
+        }
+        else
+        {
+            list->head_ = timer->next_;
+        }
+        if (timer->next_ != nullptr)
+        {
+            timer->next_->prev_ = timer->prev_;
+        }
+        timer->list_ = nullptr;
+        timer->prev_ = nullptr;
+        timer->next_ = nullptr;
+    }
+
+    // timer当前所在的槽位，不在时间轮中时为nullptr
+    static TimerList *owner(const Timer *timer) { return timer->list_; }
+
+    // 取出整个链表，槽位置空
+    Timer *take()
+    {
+        Timer *head = head_;
+        head_ = nullptr;
+        return head;
+    }
+
+    // 遍历take()返回的链表时使用，返回下一个节点并清除当前节点的链接信息
+    static Timer *detach(Timer *timer)
+    {
+        Timer *next = timer->next_;
+        timer->list_ = nullptr;
+        timer->prev_ = nullptr;
+        timer->next_ = nullptr;
+        return next;
+    }
+
+private:
+    Timer *head_;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+class Timer;
+
+/**
+ * @brief 定时器标识，由EventLoop::runAt/runAfter/runEvery返回，用于取消定时器
+ */
+class TimerId
+{
+public:
+    TimerId() : timer_(nullptr), sequence_(0) {}
+    TimerId(Timer *timer, int64_t seq) : timer_(timer), sequence_(seq) {}
+
+    friend class TimerQueue;
+
+private:
+    Timer *timer_;
+    int64_t sequence_;
+};
@@ -0,0 +1,298 @@
+#include "TimerQueue.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// 时间轮精度，1 tick = 1ms
+const int64_t kMicroSecondsPerTick = 1000;
+
+static int createTimerfd()
+{
+    int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerfd < 0)
+    {
+        LOG_FATAL("timerfd_create error: %d\n", errno);
+    }
+    return timerfd;
+}
+
+TimerQueue::TimerQueue(EventLoop *loop)
+    : loop_(loop), timerfd_(createTimerfd()), timerfdChannel_(loop, timerfd_), currentTick_(Timestamp::now().microSecondsSinceEpoch() / kMicroSecondsPerTick), armedTick_(-1), callingExpiredTimers_(false)
+{
+    ::memset(levelCount_, 0, sizeof(levelCount_));
+    timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
+    timerfdChannel_.enableReading();
+}
+
+TimerQueue::~TimerQueue()
+{
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
+    ::close(timerfd_);
+
+    for (auto &item : timers_)
+    {
+        delete item.second;
+    }
+}
+
+TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval)
+{
+    Timer *timer = new Timer(std::move(cb), when, interval);
+    loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
+    return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::cancel(TimerId timerId)
+{
+    loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(Timer *timer)
+{
+    if (timers_.empty())
+    {
+        // 时间轮为空时直接对齐当前时间，避免之后推进时逐tick追赶
+        currentTick_ = Timestamp::now().microSecondsSinceEpoch() / kMicroSecondsPerTick;
+    }
+    insert(timer);
+    timers_[timer->sequence()] = timer;
+
+    // 提前触发只会多一次唤醒，因此无需精确计算最早到期时间
+    int64_t tick = static_cast<int64_t>(expirationTick(timer->expiration()));
+    if (armedTick_ < 0 || tick < armedTick_)
+    {
+        armTimerfd(tick);
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId)
+{
+    auto it = timers_.find(timerId.sequence_);
+    if (it != timers_.end() && it->second == timerId.timer_)
+    {
+        Timer *timer = it->second;
+        TimerList *list = TimerList::owner(timer);
+        size_t level = (list >= tv1_ && list < tv1_ + kTvrSize) ? 0 : (list - &tvn_[0][0]) / kTvnSize + 1;
+        --levelCount_[level];
+        TimerList::unlink(timer);
+        timers_.erase(it);
+        delete timer;
+    }
+    else if (callingExpiredTimers_)
+    {
+        // 定时器正在执行回调(如在自身回调中取消重复定时器)，reset时不再重新加入
+        cancelingTimers_.insert(timerId.sequence_);
+    }
+}
+
+void TimerQueue::handleRead()
+{
+    uint64_t howmany = 0;
+    ssize_t n = ::read(timerfd_, &howmany, sizeof(howmany));
+    if (n != sizeof(howmany))
+    {
+        LOG_ERROR("TimerQueue::handleRead() reads %ld bytes instead of 8\n", n);
+    }
+
+    Timestamp now(Timestamp::now());
+    std::vector<Timer *> expired;
+    advance(static_cast<uint64_t>(now.microSecondsSinceEpoch() / kMicroSecondsPerTick), &expired);
+    for (Timer *timer : expired)
+    {
+        timers_.erase(timer->sequence());
+    }
+
+    callingExpiredTimers_ = true;
+    cancelingTimers_.clear();
+    for (Timer *timer : expired)
+    {
+        timer->run();
+    }
+    callingExpiredTimers_ = false;
+
+    reset(expired, now);
+    armTimerfd(nextWakeupTick());
+}
+
+void TimerQueue::insert(Timer *timer)
+{
+    uint64_t expires = std::max(expirationTick(timer->expiration()), currentTick_);
+    uint64_t delta = expires - currentTick_;
+    if (delta >= kMaxTicks)
+    {
+        // 超出时间轮范围，先放在最高层最远的槽位，cascade时按真实到期时间重新放置
+        delta = kMaxTicks - 1;
+        expires = currentTick_ + delta;
+    }
+
+    if (delta < kTvrSize)
+    {
+        tv1_[expires & kTvrMask].push(timer);
+        ++levelCount_[0];
+        return;
+    }
+    for (int level = 0; level < kTvnLevels; ++level)
+    {
+        int shift = kTvrBits + level * kTvnBits;
+        if (delta < (1ULL << (shift + kTvnBits)))
+        {
+            tvn_[level][(expires >> shift) & kTvnMask].push(timer);
+            ++levelCount_[level + 1];
+            return;
+        }
+    }
+}
+
+int TimerQueue::cascade(int level, int index)
+{
+    Timer *timer = tvn_[level][index].take();
+    while (timer != nullptr)
+    {
+        Timer *next = TimerList::detach(timer);
+        --levelCount_[level + 1];
+        insert(timer);
+        timer = next;
+    }
+    return index;
+}
+
+void TimerQueue::advance(uint64_t nowTick, std::vector<Timer *> *expired)
+{
+    while (currentTick_ <= nowTick)
+    {
+        if (timers_.empty())
+        {
+            currentTick_ = nowTick + 1;
+            break;
+        }
+
+        int index = static_cast<int>(currentTick_ & kTvrMask);
+        if (index == 0)
+        {
+            // 底层时间轮转完一圈，逐级将上层槽位下放
+            for (int level = 0; level < kTvnLevels; ++level)
+            {
+                if (cascade(level, static_cast<int>((currentTick_ >> (kTvrBits + level * kTvnBits)) & kTvnMask)) != 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        if (levelCount_[0] == 0)
+        {
+            // 底层为空，直接跳到下一个cascade点
+            currentTick_ = std::min((currentTick_ | kTvrMask) + 1, nowTick + 1);
+            continue;
+        }
+
+        Timer *timer = tv1_[index].take();
+        while (timer != nullptr)
+        {
+            Timer *next = TimerList::detach(timer);
+            --levelCount_[0];
+            expired->push_back(timer);
+            timer = next;
+        }
+        ++currentTick_;
+    }
+}
+
+void TimerQueue::reset(const std::vector<Timer *> &expired, Timestamp now)
+{
+    for (Timer *timer : expired)
+    {
+        if (timer->repeat() && cancelingTimers_.find(timer->sequence()) == cancelingTimers_.end())
+        {
+            timer->restart(now);
+            insert(timer);
+            timers_[timer->sequence()] = timer;
+        }
+        else
+        {
+            delete timer;
+        }
+    }
+}
+
+int64_t TimerQueue::nextWakeupTick() const
+{
+    if (timers_.empty())
+    {
+        return -1;
+    }
+
+    if (levelCount_[0] > 0)
+    {
+        uint64_t boundary = (currentTick_ | kTvrMask) + 1;
+        for (uint64_t tick = currentTick_; tick < boundary; ++tick)
+        {
+            if (!tv1_[tick & kTvrMask].empty())
+            {
+                return static_cast<int64_t>(tick);
+            }
+        }
+        return static_cast<int64_t>(boundary);
+    }
+
+    for (int level = 0; level < kTvnLevels; ++level)
+    {
+        if (levelCount_[level + 1] == 0)
+        {
+            continue;
+        }
+        int shift = kTvrBits + level * kTvnBits;
+        uint64_t base = (currentTick_ >> (shift + kTvnBits)) << (shift + kTvnBits);
+        uint64_t slot = (currentTick_ >> shift) & kTvnMask;
+        // currentTick_恰好位于尚未处理的cascade点时，当前槽位也还未下放
+        if ((currentTick_ & ((1ULL << shift) - 1)) != 0)
+        {
+            ++slot;
+        }
+        for (; slot < kTvnSize; ++slot)
+        {
+            if (!tvn_[level][slot].empty())
+            {
+                return static_cast<int64_t>(base | (slot << shift));
+            }
+        }
+        // 剩余定时器在本层转完一圈后才会下放
+        return static_cast<int64_t>(base + (1ULL << (shift + kTvnBits)));
+    }
+    return -1;
+}
+
+void TimerQueue::armTimerfd(int64_t tick)
+{
+    armedTick_ = tick;
+
+    struct itimerspec newValue;
+    ::memset(&newValue, 0, sizeof(newValue));
+    if (tick >= 0)
+    {
+        int64_t microseconds = tick * kMicroSecondsPerTick - Timestamp::now().microSecondsSinceEpoch();
+        if (microseconds < 100)
+        {
+            microseconds = 100;
+        }
+        newValue.it_value.tv_sec = static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
+        newValue.it_value.tv_nsec = static_cast<long>((microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+    }
+
+    if (::timerfd_settime(timerfd_, 0, &newValue, nullptr) < 0)
+    {
+        LOG_ERROR("timerfd_settime error: %d\n", errno);
+    }
+}
+
+uint64_t TimerQueue::expirationTick(Timestamp when)
+{
+    // 向上取整，保证定时器不会提前触发
+    return static_cast<uint64_t>((when.microSecondsSinceEpoch() + kMicroSecondsPerTick - 1) / kMicroSecondsPerTick);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Callbacks.h"
+#include "Channel.h"
+#include "Timer.h"
+#include "TimerId.h"
+#include "Timestamp.h"
+#include "noncopyable.h"
+
+#include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class EventLoop;
+
+/**
+ * @brief 定时器队列，每个EventLoop拥有一个，通过timerfd注册为Channel
+ * 定时器按1ms精度存放在分层时间轮中(256 + 64 * 3个槽位)，插入和取消均为O(1)，
+ * 高层槽位在低层时间轮转完一圈时逐级下放(cascade)
+ */
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 添加定时器，线程安全
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+
+    // 取消定时器，线程安全
+    void cancel(TimerId timerId);
+
+private:
+    static const int kTvrBits = 8;
+    static const int kTvnBits = 6;
+    static const int kTvrSize = 1 << kTvrBits;
+    static const int kTvnSize = 1 << kTvnBits;
+    static const uint64_t kTvrMask = kTvrSize - 1;
+    static const uint64_t kTvnMask = kTvnSize - 1;
+    static const int kTvnLevels = 3;
+    static const uint64_t kMaxTicks = 1ULL << (kTvrBits + kTvnLevels * kTvnBits); // 时间轮可表示的最大tick跨度
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+
+    // timerfd读事件回调
+    void handleRead();
+
+    // 按到期tick将timer放入对应层级的槽位
+    void insert(Timer *timer);
+    // 将第level层upper时间轮index槽位中的定时器重新放入时间轮，返回index
+    int cascade(int level, int index);
+    // 推进时间轮至nowTick，收集所有到期的定时器
+    void advance(uint64_t nowTick, std::vector<Timer *> *expired);
+    // 重新放入到期的重复定时器，释放一次性定时器
+    void reset(const std::vector<Timer *> &expired, Timestamp now);
+    // 下一次需要唤醒的tick，没有定时器时返回-1
+    int64_t nextWakeupTick() const;
+    // 设置timerfd在tick时刻触发
+    void armTimerfd(int64_t tick);
+
+    static uint64_t expirationTick(Timestamp when);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+
+    TimerList tv1_[kTvrSize];
+    TimerList tvn_[kTvnLevels][kTvnSize];
+    size_t levelCount_[kTvnLevels + 1]; // 各层中的定时器数量
+    uint64_t currentTick_;              // 时间轮当前处理到的tick(ms)
+    int64_t armedTick_;                 // timerfd当前设置的触发tick，-1表示未设置
+
+    std::unordered_map<int64_t, Timer *> timers_; // sequence => 时间轮中的定时器
+
+    bool callingExpiredTimers_;
+    std::unordered_set<int64_t> cancelingTimers_; // 回调执行期间被取消的定时器
+};
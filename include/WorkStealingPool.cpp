@@ -0,0 +1,177 @@
+#include "WorkStealingPool.h"
+#include "Logger.h"
+#include "Thread.h"
+
+#include <chrono>
+#include <sched.h>
+
+namespace
+{
+    // 当前线程所属的线程池及其工作线程下标，用于判断是否为本池内部提交
+    __thread WorkStealingPool *t_pool = nullptr;
+    __thread size_t t_workerIndex = 0;
+}
+
+const int WorkStealingPool::kMaxIdleSpins;
+const int WorkStealingPool::kRetryWaitMicroSeconds; // 以引用传给std::chrono::microseconds，需要类外定义
+
+WorkStealingPool::WorkStealingPool(const std::string &nameArg)
+    : name_(nameArg), running_(false), nextWorker_(0), pending_(0), idle_(0)
+{
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    stop();
+}
+
+void WorkStealingPool::start(int numThreads)
+{
+    if (numThreads <= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        numThreads = ::sched_getaffinity(0, sizeof(set), &set) == 0 ? CPU_COUNT(&set) : 1;
+    }
+
+    running_ = true;
+    for (int i = 0; i < numThreads; ++i)
+    {
+        workers_.push_back(std::unique_ptr<Worker>(new Worker));
+    }
+    // 先创建全部队列再启动线程，工作线程窃取时会访问所有队列
+    for (int i = 0; i < numThreads; ++i)
+    {
+        std::string threadName = name_ + std::to_string(i);
+        workers_[i]->thread.reset(new Thread(std::bind(&WorkStealingPool::workerFunc, this, static_cast<size_t>(i)), threadName));
+        workers_[i]->thread->start();
+    }
+}
+
+void WorkStealingPool::stop()
+{
+    if (!running_.exchange(false))
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        sleepCond_.notify_all();
+    }
+    for (auto &worker : workers_)
+    {
+        worker->thread->join();
+    }
+}
+
+bool WorkStealingPool::submit(Task task)
+{
+    if (workers_.empty())
+    {
+        LOG_ERROR("WorkStealingPool::submit [%s] - pool not started, run task in caller thread\n", name_.c_str());
+        task();
+        return true;
+    }
+
+    bool inWorker = t_pool == this;
+    // 先计数再入队：取走任务后的fetch_sub不会使计数暂时为负，stop()时工作线程也不会在任务入队前看到pending_为0而退出
+    pending_.fetch_add(1);
+    // 计数之后再检查running_：若工作线程已看到pending_为0而退出，这里一定能看到running_为false。
+    // 工作线程自己提交的任务仍然接受，它会在退出前从自己的队列中取出执行
+    if (!inWorker && !running_)
+    {
+        pending_.fetch_sub(1);
+        LOG_ERROR("WorkStealingPool::submit [%s] - pool stopped, task dropped\n", name_.c_str());
+        return false;
+    }
+
+    size_t index = inWorker ? t_workerIndex : nextWorker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    Worker &worker = *workers_[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+
+    if (idle_.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        sleepCond_.notify_one();
+    }
+    return true;
+}
+
+bool WorkStealingPool::take(size_t index, Task *task)
+{
+    {
+        Worker &self = *workers_[index];
+        std::lock_guard<std::mutex> lock(self.mutex);
+        if (!self.tasks.empty())
+        {
+            *task = std::move(self.tasks.back());
+            self.tasks.pop_back();
+            pending_.fetch_sub(1);
+            return true;
+        }
+    }
+
+    size_t n = workers_.size();
+    for (size_t i = 1; i < n; ++i)
+    {
+        Worker &victim = *workers_[(index + i) % n];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (lock.owns_lock() && !victim.tasks.empty())
+        {
+            *task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending_.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerFunc(size_t index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+
+    Task task;
+    int spins = 0;
+    while (true)
+    {
+        if (take(index, &task))
+        {
+            task();
+            task = nullptr;
+            spins = 0;
+            continue;
+        }
+
+        // 仍有任务(正在入队，或队列被其他线程锁住导致窃取失败)时让出cpu后重试，最多kMaxIdleSpins次
+        if (pending_.load() > 0 && spins < kMaxIdleSpins)
+        {
+            ++spins;
+            sched_yield();
+            continue;
+        }
+        spins = 0;
+        if (!running_ && pending_.load() == 0)
+        {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        ++idle_;
+        if (pending_.load() > 0)
+        {
+            // 任务暂时取不到，休眠片刻再重试，submit的notify也会提前唤醒
+            sleepCond_.wait_for(lock, std::chrono::microseconds(kRetryWaitMicroSeconds));
+        }
+        else
+        {
+            sleepCond_.wait(lock, [this]()
+                            { return pending_.load() > 0 || !running_; });
+        }
+        --idle_;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "EventLoop.h"
+#include "Task.h"
+#include "noncopyable.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class Thread;
+
+/**
+ * @brief 工作窃取计算线程池，用于把解析、压缩、加解密等CPU密集的处理移出subloop
+ * 每个工作线程有自己的任务双端队列：本线程提交的任务压入自己队列尾部并从尾部取(LIFO，缓存友好)，
+ * 外部线程提交的任务轮流分配到各队列；自己队列为空时从其他线程队列头部窃取
+ */
+class WorkStealingPool : noncopyable
+{
+public:
+    explicit WorkStealingPool(const std::string &nameArg = std::string("ComputePool"));
+    ~WorkStealingPool();
+
+    // 启动numThreads个工作线程，numThreads<=0时使用可用cpu核心数
+    void start(int numThreads);
+    // 执行完已提交的任务后退出所有工作线程
+    void stop();
+
+    int numThreads() const { return static_cast<int>(workers_.size()); }
+    const std::string &name() const { return name_; }
+
+    // 提交任务，可在任意线程调用；stop()之后由外部线程提交的任务不会执行，记录错误并返回false
+    bool submit(Task task);
+
+    /**
+     * @brief 在线程池中执行work，完成后回到loop线程以work的返回值调用done(work返回void时调用done())
+     * 例如在MessageCallback中：
+     * pool->submit(conn->getLoop(), std::bind(compress, buf->retrieveAllAsString()), [conn](const std::string &out) { conn->send(out); });
+     */
+    template <typename Work, typename Done>
+    bool submit(EventLoop *loop, Work work, Done done)
+    {
+        return submit(Task(Completion<Work, Done>(loop, std::move(work), std::move(done))));
+    }
+
+private:
+    static const int kMaxIdleSpins = 64;            // 有任务但取不到时，进入休眠前最多让出cpu的次数
+    static const int kRetryWaitMicroSeconds = 100; // 上述情况下每次休眠的时间
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::unique_ptr<Thread> thread;
+    };
+
+    template <typename Work, typename Done>
+    struct Completion
+    {
+        Completion(EventLoop *l, Work w, Done d) : loop(l), work(std::move(w)), done(std::move(d)) {}
+
+        void operator()() { run(std::is_void<decltype(work())>()); }
+
+        void run(std::true_type)
+        {
+            work();
+            loop->runInLoop(std::move(done));
+        }
+        void run(std::false_type) { loop->runInLoop(std::bind(std::move(done), work())); }
+
+        EventLoop *loop;
+        Work work;
+        Done done;
+    };
+
+    void workerFunc(size_t index);
+    // 先取自己队列尾部，再从其他队列头部窃取
+    bool take(size_t index, Task *task);
+
+    const std::string name_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic_bool running_;
+    std::atomic<size_t> nextWorker_; // 外部线程提交时轮流选择的队列
+
+    // 空闲线程休眠；pending_与idle_使用seq_cst，保证提交者与即将休眠的线程至少一方看到对方
+    std::atomic<size_t> pending_;
+    std::atomic_int idle_;
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCond_;
+};